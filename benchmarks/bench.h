@@ -0,0 +1,212 @@
+/// @brief Shared helpers for the benchmark programs: command line options, input sizes, test data & JSON output.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "utilities/benchmark.h"
+#include "utilities/macros.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/// @brief The command line options shared by all the benchmark programs.
+/// @note  Usage: `prog [--min-size 1K] [--max-size 32M] [--samples 20] [--json results.json]`. Sizes take the usual
+///        K, M, & G suffixes. Inputs run from 1K to 32M by default -- pass `--max-size 1G` for the full sweep.
+struct options {
+    std::size_t min_size = 1024;
+    std::size_t max_size = 32 * 1024 * 1024;
+    std::size_t samples = 20;
+    std::string json;
+
+    options(int argc, char* argv[])
+    {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            if (i + 1 == argc) usage(argv[0], arg);
+            std::string_view value = argv[++i];
+            if (arg == "--min-size")
+                min_size = parse_size(value);
+            else if (arg == "--max-size")
+                max_size = parse_size(value);
+            else if (arg == "--samples")
+                samples = std::max(parse_size(value), std::size_t{1});
+            else if (arg == "--json")
+                json = value;
+            else
+                usage(argv[0], arg);
+        }
+    }
+
+    /// @brief The input sizes to run each benchmark on -- powers of 32 from 1K up to 1G that are in range.
+    std::vector<std::size_t> sizes() const
+    {
+        std::vector<std::size_t> retval;
+        for (std::size_t n = 1024; n <= std::size_t{1} << 30; n *= 32)
+            if (n >= min_size && n <= max_size) retval.push_back(n);
+        return retval;
+    }
+
+    /// @brief Class method that parses a size like "64K", "32M", or "1G".
+    static std::size_t parse_size(std::string_view str)
+    {
+        std::size_t scale = 1;
+        if (!str.empty()) {
+            switch (str.back()) {
+                case 'K': case 'k': scale = std::size_t{1} << 10; break;
+                case 'M': case 'm': scale = std::size_t{1} << 20; break;
+                case 'G': case 'g': scale = std::size_t{1} << 30; break;
+                default: break;
+            }
+            if (scale != 1) str.remove_suffix(1);
+        }
+        return std::stoull(std::string{str}) * scale;
+    }
+
+    [[noreturn]] static void usage(std::string_view prog, std::string_view arg)
+    {
+        std::cerr << std::format("Unexpected argument '{}'\n", arg);
+        std::cerr << std::format("Usage: {} [--min-size 1K] [--max-size 32M] [--samples 20] [--json file]\n", prog);
+        std::exit(1);
+    }
+};
+
+/// @brief Returns a size as a short label e.g. "1K", "32M", or "1G".
+inline std::string
+size_label(std::size_t n)
+{
+    if (n >= std::size_t{1} << 30 && n % (std::size_t{1} << 30) == 0) return std::format("{}G", n >> 30);
+    if (n >= std::size_t{1} << 20 && n % (std::size_t{1} << 20) == 0) return std::format("{}M", n >> 20);
+    if (n >= std::size_t{1} << 10 && n % (std::size_t{1} << 10) == 0) return std::format("{}K", n >> 10);
+    return std::format("{}", n);
+}
+
+/// @brief Creates a benchmark for inputs of a particular size with the sampling scaled back for the big sizes.
+template<typename Clock = std::chrono::high_resolution_clock>
+utilities::benchmark<Clock>
+make_benchmark(const std::string& name, std::size_t size, const options& opts)
+{
+    utilities::benchmark<Clock> retval{name};
+    auto                        big = size >= std::size_t{32} << 20;
+    retval.samples(big ? std::min<std::size_t>(opts.samples, 5) : opts.samples);
+    retval.warmup(big ? 0 : 0.05);
+    retval.sample_time(big ? 0 : 0.01);
+    return retval;
+}
+
+/// @brief Returns about `size` bytes of text made up of lines of words, numbers, & punctuation with messy spacing.
+/// @note  This is the sort of thing the string & stream functions spend their lives chewing through.
+inline std::string
+make_text(std::size_t size, std::uint32_t seed = 42)
+{
+    static constexpr std::string_view words[] = {
+        "alpha", "Bravo", "charlie", "DELTA", "echo", "foxtrot", "golf", "Hotel", "india", "juliet",
+        "kilo",  "lima",  "mike",    "NOVEMBER", "oscar", "papa", "quebec", "romeo", "sierra", "tango"};
+    static constexpr std::string_view gaps[] = {" ", " ", " ", "  ", "\t", ", ", " ; "};
+
+    std::mt19937                               gen{seed};
+    std::uniform_int_distribution<std::size_t> word(0, std::size(words) - 1);
+    std::uniform_int_distribution<std::size_t> gap(0, std::size(gaps) - 1);
+    std::uniform_int_distribution<int>         kind(0, 9);
+    std::uniform_int_distribution<int>         number(-100000, 100000);
+    std::uniform_int_distribution<int>         line_length(4, 16);
+
+    std::string retval;
+    retval.reserve(size + 256);
+    while (retval.size() < size) {
+        auto n = line_length(gen);
+        for (int i = 0; i < n; ++i) {
+            if (i > 0) retval += gaps[gap(gen)];
+            auto k = kind(gen);
+            if (k < 6)
+                retval += words[word(gen)];
+            else if (k < 8)
+                std::format_to(std::back_inserter(retval), "{}", number(gen));
+            else
+                std::format_to(std::back_inserter(retval), "{:.3f}", number(gen) / 997.0);
+        }
+        retval += '\n';
+    }
+    retval.resize(size);
+    return retval;
+}
+
+/// @brief Writes some text to a file & removes the file again when the object goes out of scope.
+class temp_file {
+public:
+    temp_file(const std::string& name, std::string_view contents) : m_path{name}
+    {
+        std::ofstream file{m_path, std::ios::binary};
+        if (!file) throw std::runtime_error(std::format("Failed to create '{}'", m_path));
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+    ~temp_file() { std::remove(m_path.c_str()); }
+
+    temp_file(const temp_file&) = delete;
+    temp_file& operator=(const temp_file&) = delete;
+
+    const std::string& path() const { return m_path; }
+
+private:
+    std::string m_path;
+};
+
+/// @brief Collects the benchmarks run by a program, prints their tables, & optionally saves them all as JSON.
+class suite {
+public:
+    suite(std::string name, const options& opts) : m_name{std::move(name)}, m_opts{opts} {}
+
+    /// @brief Adds a finished benchmark to the suite & prints its table of results.
+    template<typename Clock>
+    void add(const utilities::benchmark<Clock>& b)
+    {
+        std::cout << b << std::endl;
+        m_json.push_back(b.to_json());
+    }
+
+    /// @brief Writes the JSON for the suite if that was asked for on the command line.
+    /// @note  The output has the suite name, the compiler, the time of the run (in Unix seconds), & an array of the
+    ///        benchmark tables.
+    int finish() const
+    {
+        if (m_opts.json.empty()) return 0;
+        std::ofstream file{m_opts.json};
+        if (!file) {
+            std::cerr << std::format("Failed to open '{}' for the JSON output\n", m_opts.json);
+            return 1;
+        }
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(now).count();
+        std::string header = "{\"suite\":";
+        utilities::json_string_to(std::back_inserter(header), m_name);
+        header += ",\"compiler\":";
+        utilities::json_string_to(std::back_inserter(header), COMPILER_NAME);
+        std::format_to(std::back_inserter(header), ",\"unix_time\":{},\"benchmarks\":[", secs);
+        file << header;
+        for (std::size_t i = 0; i < m_json.size(); ++i) file << (i > 0 ? ",\n" : "\n") << m_json[i];
+        file << "\n]}\n";
+        std::cout << std::format("Saved the results to '{}'\n", m_opts.json);
+        return 0;
+    }
+
+private:
+    std::string              m_name;
+    const options&           m_opts;
+    std::vector<std::string> m_json;
+};
+
+} // namespace bench
@@ -0,0 +1,44 @@
+/// @brief Benchmarks for formatting ranges of numbers with the range formatter in `format.h`.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "bench.h"
+
+#include "utilities/format.h"
+
+#include <list>
+#include <random>
+#include <vector>
+
+int
+main(int argc, char* argv[])
+{
+    bench::options opts{argc, argv};
+    bench::suite   suite{"format", opts};
+
+    std::mt19937 gen{42};
+    for (auto size : opts.sizes()) {
+        // Enough numbers to make about `size` bytes of formatted output.
+        std::uniform_int_distribution<int>     ints(-1000000, 1000000);
+        std::uniform_real_distribution<double> reals(-1000, 1000);
+        std::vector<int>                       vi(std::max<std::size_t>(size / 9, 1));
+        std::vector<double>                    vd(std::max<std::size_t>(size / 19, 1));
+        for (auto& x : vi) x = ints(gen);
+        for (auto& x : vd) x = reals(gen);
+        std::list<int> li(vi.begin(), vi.end());
+
+        auto b = bench::make_benchmark(std::format("Ranges for about {} of output", bench::size_label(size)), size,
+                                       opts);
+        b.bytes(static_cast<double>(size));
+
+        b.items(static_cast<double>(vi.size()));
+        b.run("vector<int> {}", [&] { return std::format("{}", vi); });
+        b.run("list<int> {}", [&] { return std::format("{}", li); });
+        b.run("vector<int> {::d}", [&] { return std::format("{::d}", vi); });
+
+        b.items(static_cast<double>(vd.size()));
+        b.run("vector<double> {}", [&] { return std::format("{}", vd); });
+        b.run("vector<double> {::.3f}", [&] { return std::format("{::.3f}", vd); });
+
+        suite.add(b);
+    }
+    return suite.finish();
+}
@@ -0,0 +1,61 @@
+/// @brief Benchmarks for `LOG` throughput through each of the message handlers in `log.h`.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "bench.h"
+
+#include "utilities/log.h"
+
+#include <atomic>
+#include <memory>
+
+using namespace utilities;
+
+// A sink that just counts what it is given so we measure the cost of logging & not the cost of the terminal.
+class null_sink : public log_sink {
+public:
+    void        write(std::string_view block) override { m_bytes.fetch_add(block.size(), std::memory_order_relaxed); }
+    std::size_t bytes() const { return m_bytes.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::size_t> m_bytes = 0;
+};
+
+int
+main(int argc, char* argv[])
+{
+    bench::options opts{argc, argv};
+    bench::suite   suite{"log", opts};
+
+    auto sink = std::make_shared<null_sink>();
+    message::use_sink(sink);
+
+    for (auto size : opts.sizes()) {
+        // Each message comes out at something like 100 bytes so we log enough of them to produce about `size` bytes.
+        auto count = std::max<std::size_t>(size / 100, 1);
+        auto b = bench::make_benchmark(std::format("LOG for about {} of output", bench::size_label(size)), size, opts);
+        b.items(static_cast<double>(count));
+
+        auto log_all = [&] {
+            for (std::size_t i = 0; i < count; ++i) LOG("Processed record {} with value {:.3f}", i, 0.5 * double(i));
+            message::flush();
+        };
+
+        message::use_default_handler();
+        b.run("default handler", log_all);
+
+        message::use_buffered_handler();
+        b.run("buffered handler", log_all);
+
+        message::use_async_handler();
+        b.run("async handler", log_all);
+
+        // Messages below the runtime threshold should cost next to nothing.
+        message::use_default_handler();
+        message::threshold(log_level::warn);
+        b.run("filtered out", log_all);
+        message::threshold(log_level::trace);
+
+        suite.add(b);
+    }
+    message::use_default_handler();
+    return suite.finish();
+}
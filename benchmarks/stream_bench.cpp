@@ -0,0 +1,70 @@
+/// @brief Benchmarks for reading & counting the 'lines' in files with `stream.h` on files from 1K up to 1G.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "bench.h"
+
+#include "utilities/stream.h"
+
+using namespace utilities;
+
+// Text with the odd comment, blank line, & continuation mixed in with the usual lines.
+std::string
+make_file_text(std::size_t size)
+{
+    auto        text = bench::make_text(size);
+    std::string retval;
+    retval.reserve(text.size() + text.size() / 8);
+    std::size_t line = 0;
+    for (std::size_t begin = 0; begin < text.size();) {
+        auto end = std::min(text.find('\n', begin), text.size());
+        retval.append(text, begin, end - begin);
+        if (line % 10 == 3) retval += "  # a trailing comment";
+        if (line % 25 == 7) retval += " \\";
+        if (line % 50 == 11) retval += "\n   ";
+        retval += '\n';
+        begin = end + 1;
+        ++line;
+    }
+    return retval;
+}
+
+int
+main(int argc, char* argv[])
+{
+    bench::options opts{argc, argv};
+    bench::suite   suite{"stream", opts};
+
+    for (auto size : opts.sizes()) {
+        bench::temp_file file{"utilities_stream_bench.txt", make_file_text(size)};
+        auto b = bench::make_benchmark(std::format("stream.h on a {} file", bench::size_label(size)), size, opts);
+        b.bytes(static_cast<double>(size));
+
+        // Reading the lines through a stream into a reused string.
+        b.run("read_line (stream)", [&] {
+            std::ifstream is{file.path()};
+            std::string   line;
+            std::size_t   chars = 0;
+            while (read_line(is, line) > 0) chars += line.size();
+            return chars;
+        });
+
+        // Reading the lines as views into the memory-mapped file.
+        b.run("read_line (mapped)", [&] {
+            line_reader      reader{file.path()};
+            std::string_view line;
+            std::size_t      chars = 0;
+            while (reader.read_line(line) > 0) chars += line.size();
+            return chars;
+        });
+
+        // Counting lines the old way & the parallel memory-mapped way with & without the `read_line` semantics.
+        b.run("line_count (stream)", [&] {
+            std::ifstream is{file.path()};
+            return line_count(is);
+        });
+        b.run("line_count (mapped)", [&] { return line_count(std::filesystem::path{file.path()}); });
+        b.run("line_count (mapped, raw)", [&] { return line_count(std::filesystem::path{file.path()}, ""); });
+
+        suite.add(b);
+    }
+    return suite.finish();
+}
@@ -0,0 +1,64 @@
+/// @brief Benchmarks for the hot paths in `string.h` on inputs from 1K up to 1G.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "bench.h"
+
+#include "utilities/string.h"
+
+using namespace utilities;
+
+int
+main(int argc, char* argv[])
+{
+    bench::options opts{argc, argv};
+    bench::suite   suite{"string", opts};
+
+    for (auto size : opts.sizes()) {
+        auto text = bench::make_text(size);
+        auto b = bench::make_benchmark(std::format("string.h on {} of text", bench::size_label(size)), size, opts);
+        b.bytes(static_cast<double>(text.size()));
+
+        // Tokenizing into a vector of strings.
+        b.run("split", [&] { return split(text); });
+
+        // Replacing a common word with a longer one & a common pair of characters with nothing.
+        b.run("replace (grow)", [&] {
+            auto s = text;
+            replace(s, "echo", "ECHO-ECHO");
+            return s;
+        });
+        b.run("replace (shrink)", [&] {
+            auto s = text;
+            replace(s, ", ", "");
+            return s;
+        });
+
+        // Whitespace clean ups.
+        b.run("condense", [&] {
+            auto s = text;
+            condense(s);
+            return s;
+        });
+        b.run("standardize", [&] {
+            auto s = text;
+            standardize(s);
+            return s;
+        });
+
+        // Parsing every token as a number with `possible<T>` (most of them turn out not to be numbers).
+        auto tokens = split(text);
+        b.items(static_cast<double>(tokens.size()));
+        b.run("possible<int>", [&] {
+            std::size_t hits = 0;
+            for (const auto& token : tokens) hits += possible<int>(token).has_value();
+            return hits;
+        });
+        b.run("possible<double>", [&] {
+            std::size_t hits = 0;
+            for (const auto& token : tokens) hits += possible<double>(token).has_value();
+            return hits;
+        });
+
+        suite.add(b);
+    }
+    return suite.finish();
+}
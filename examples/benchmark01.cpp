@@ -0,0 +1,35 @@
+/// @brief Exercise the microbenchmark harness.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/benchmark.h"
+#include "utilities/print.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+int
+main()
+{
+    std::vector<int> data(10'000);
+    std::mt19937     rng{42};
+    for (auto& x : data) x = static_cast<int>(rng());
+
+    utilities::benchmark bench{"Sorting & summing 10,000 ints"};
+    bench.items(static_cast<double>(data.size())).bytes(static_cast<double>(data.size() * sizeof(int)));
+
+    // The callable returns a value so the harness makes sure the sum is actually computed.
+    bench.run("accumulate", [&] { return std::accumulate(data.begin(), data.end(), 0L); });
+
+    // The result of the sort is never looked at so we use a barrier to stop the compiler removing the work.
+    bench.run("sort", [&] {
+        auto copy = data;
+        std::sort(copy.begin(), copy.end());
+        utilities::do_not_optimize(copy.data());
+        utilities::clobber_memory();
+    });
+
+    std::print("{}", bench);
+    std::print("{}\n", bench.results().front());
+    return 0;
+}
@@ -0,0 +1,36 @@
+/// @brief Use a counting stopwatch to see where the time goes in a few different laps.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+#include <numeric>
+#include <random>
+#include <thread>
+
+int
+main()
+{
+    // A big table we will walk through in order & then in a random order.
+    std::vector<std::size_t> next(std::size_t{1} << 23);
+    std::iota(next.begin(), next.end(), std::size_t{0});
+    std::vector<std::size_t> shuffled = next;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{42});
+
+    utilities::counting_stopwatch sw;
+    if (!sw.counters().available()) std::print("NOTE: No hardware counters here -- only the times are meaningful.\n");
+
+    std::size_t sum = 0;
+    for (auto i : next) sum += next[i];
+    sw.click();
+    std::print("Sequential: {}\n", sw);
+
+    for (auto i : shuffled) sum += next[i];
+    sw.click();
+    std::print("Random:     {}\n", sw);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    sw.click();
+    std::print("Sleeping:   {}\n", sw);
+
+    std::print("Sum: {}\n", sum);
+    return 0;
+}
@@ -0,0 +1,19 @@
+/// @brief Intern some standardized card names & use the symbols as keys.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+#include <unordered_map>
+
+int
+main()
+{
+    std::unordered_map<utilities::symbol, int> score;
+    score[utilities::intern_standardized("Ace of Clubs")] = 11;
+    score[utilities::intern_standardized("King of Hearts")] = 10;
+
+    for (auto card : {"[ace of clubs]", "  KING of   hearts  ", "(two of spades)"}) {
+        auto sym = utilities::intern_standardized(card);
+        std::print("'{}' -> '{}' with id {} scores {}\n", card, sym, sym.id(), score[sym]);
+    }
+    return 0;
+}
@@ -0,0 +1,22 @@
+/// @brief Printing large numbers with separators without touching any locale.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+int
+main()
+{
+    double x = 123456789.123456789;
+    long   n = -98765432;
+
+    std::print("No separators:                  {:>20.5f} and {}\n", x, n);
+    std::print("Wrapped in grouped(...):        {:>20.5f} and {}\n", utilities::grouped(x), utilities::grouped(n));
+    std::print("Underscores from the spec:      {:>20_.5f} and {:_}\n", utilities::grouped(x), utilities::grouped(n));
+    std::print("European style separators:      {:>20.5f} and {}\n", utilities::grouped(x, '.', ','),
+               utilities::grouped(n, '.'));
+
+    // The raw version is the fastest of all.
+    char buffer[32];
+    auto [end, ec] = utilities::to_chars_grouped(buffer, buffer + sizeof(buffer), n);
+    std::print("From to_chars_grouped(...):     {}\n", std::string_view{buffer, end});
+    return 0;
+}
@@ -0,0 +1,26 @@
+/// @brief Exercise the asynchronous message handler with several producer threads.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/log.h"
+
+#include <thread>
+#include <vector>
+
+int
+main()
+{
+    // Queue messages for a background writer -- drop the oldest pending ones if that writer falls too far behind.
+    utilities::message::use_async_handler(utilities::overflow_policy::drop_oldest, 1024);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 1000; ++i) LOG("thread {} message {}", t, i);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    // Make sure everything queued so far is written out before we report on what got dropped.
+    utilities::message::flush();
+    std::cout << "Messages dropped: " << utilities::message::dropped() << '\n';
+    return 0;
+}
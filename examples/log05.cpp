@@ -0,0 +1,22 @@
+/// @brief Exercise the rate limited logging macros in a tight loop.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/log.h"
+
+#include <chrono>
+
+int
+main()
+{
+    // Only every 100,000th message gets formatted & printed -- the others just bump a counter.
+    for (int i = 0; i < 1'000'000; ++i) LOG_EVERY_N(100'000, "iteration {}", i);
+
+    // Only the first three messages from this call site get printed.
+    for (int i = 0; i < 10; ++i) LOG_FIRST_N(3, "iteration {}", i);
+
+    // At most one message every 10ms gets printed.
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(50))
+        LOG_EVERY_T(0.01, "still spinning");
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+/// @brief Count, gauge, & time requests on several threads with the metrics reported through the log.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/metrics.h"
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+double
+handle(int n)
+{
+    static const utilities::gauge in_flight{"requests.in_flight"};
+    in_flight.increment();
+    METRIC_COUNT("requests");
+    METRIC_TIME_SCOPE("requests.latency");
+
+    double sum = 0;
+    for (int i = 0; i < n; ++i) sum += std::sqrt(static_cast<double>(i));
+    if (n % 7 == 0) METRIC_COUNT("requests.slow_path");
+    in_flight.decrement();
+    return sum;
+}
+
+int
+main()
+{
+    // Report every 100ms -- the default exporter sends each metric through the log.
+    utilities::metrics_registry::start_reporting(0.1);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) threads.emplace_back([t] {
+        auto stop = std::chrono::steady_clock::now() + std::chrono::milliseconds(250);
+        for (int i = 0; std::chrono::steady_clock::now() < stop; ++i)
+            if (handle(1000 + i % 1000 + t) < 0) std::cout << "Impossible!\n";
+    });
+    for (auto& thread : threads) thread.join();
+
+    // Stopping the reporter reports the last partial interval on the way out.
+    utilities::metrics_registry::stop_reporting();
+    return 0;
+}
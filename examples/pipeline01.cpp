@@ -0,0 +1,27 @@
+/// @brief Parse the "<id> <value>" records in a big file on all the cores & sum the values in file order.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+int
+main(int argc, char* argv[])
+{
+    // Must have exactly 1 argument (name of file to read from)
+    if (argc != 2) exit_with_message("Usage: '{} <filename>' -- missing filename argument!", argv[0]);
+
+    // The batches arrive in file order on this thread so there is no need for any locking.
+    std::size_t first_id = 0, last_id = 0;
+    double      sum = 0;
+    auto        consume = [&](std::vector<std::tuple<std::size_t, double>>& batch) {
+        if (batch.empty()) return;
+        if (first_id == 0) first_id = std::get<0>(batch.front());
+        last_id = std::get<0>(batch.back());
+        for (const auto& [id, value] : batch) sum += value;
+    };
+
+    utilities::stopwatch sw;
+    auto                 stats = utilities::parse_records<std::size_t, double>(argv[1], consume);
+    std::print("Parsed {} records from {} lines ({} rejected) in {} batches taking {}\n", stats.records, stats.lines,
+               stats.rejected, stats.batches, sw);
+    std::print("Ids run from {} to {} and the values sum to {}\n", first_id, last_id, sum);
+    return 0;
+}
@@ -0,0 +1,47 @@
+/// @brief Exercise the profiling zones from several threads.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/format.h"
+#include "utilities/print.h"
+#include "utilities/profile.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+double
+parse(int n)
+{
+    PROFILE_FUNCTION();
+    double sum = 0;
+    for (int i = 0; i < n; ++i) sum += std::sqrt(static_cast<double>(i));
+    return sum;
+}
+
+double
+work(int t)
+{
+    PROFILE_SCOPE("work");
+    double sum = 0;
+    for (int i = 0; i < 1000; ++i) {
+        sum += parse(1000 + t);
+        if (i % 100 == 0) {
+            PROFILE_SCOPE("sleep");
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    return sum;
+}
+
+int
+main()
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) threads.emplace_back([t] {
+        if (work(t) < 0) std::print("Impossible!\n");
+    });
+    for (auto& thread : threads) thread.join();
+
+    // The report merges the timings from all the threads.
+    std::print("{}", utilities::profile());
+    return 0;
+}
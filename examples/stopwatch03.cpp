@@ -0,0 +1,36 @@
+/// @brief Collect the distribution of lap times from several threads using latency recorders.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/format.h"
+#include "utilities/print.h"
+#include "utilities/stopwatch.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+int
+main()
+{
+    // Each thread records into its own recorder so there is no contention.
+    std::vector<utilities::latency_recorder<>> recorders(4);
+    std::vector<std::thread>                   threads;
+    for (auto& recorder : recorders) {
+        threads.emplace_back([&recorder] {
+            double sum = 0;
+            recorder.restart();
+            for (int i = 0; i < 100'000; ++i) {
+                for (int j = 0; j < 100 + i % 50; ++j) sum += std::sqrt(static_cast<double>(j));
+                recorder.click();
+            }
+            if (sum < 0) std::print("Impossible!\n");
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    // Merge the per-thread histograms to get the overall picture.
+    utilities::latency_recorder<> total{"All threads"};
+    for (const auto& recorder : recorders) total.merge(recorder);
+    std::print("{}\n", total);
+    std::print("99.99% of laps took at most {}\n", utilities::duration_string(total.percentile(99.99)));
+    return 0;
+}
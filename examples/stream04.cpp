@@ -0,0 +1,21 @@
+/// @brief Read from a large file line by line without copying using a memory-mapped line reader.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+int
+main(int argc, char* argv[])
+{
+    // Must have exactly 1 argument (name of file to read from)
+    if (argc != 2) exit_with_message("Usage: '{} <filename>' -- missing filename argument!", argv[0]);
+
+    // Each line is a view into the memory-mapped file -- no allocations unless a line has a continuation.
+    utilities::line_reader reader{argv[1]};
+    std::string_view       line;
+    std::size_t            n_lines = 0;
+    while (reader.read_line(line) != 0) {
+        n_lines++;
+        std::print("Line #{:d}: '{}'\n", n_lines, line);
+    }
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+/// @brief Read from a file using a range of lines & tokenize them without any per-line allocations.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+#include <fstream>
+#include <ranges>
+
+int
+main(int argc, char* argv[])
+{
+    // Must have exactly 1 argument (name of file to read from)
+    if (argc != 2) exit_with_message("Usage: '{} <filename>' -- missing filename argument!", argv[0]);
+
+    // Try to open the file
+    std::ifstream file{argv[1]};
+    if (!file) exit_with_message("Failed to open file '{}'", argv[1]);
+
+    // Count the tokens on each line that has more than one of them.
+    std::vector<std::string_view> tokens;
+    auto n_tokens = [&](std::string_view line) {
+        tokens.clear();
+        utilities::tokenize(line, tokens);
+        return tokens.size();
+    };
+    auto more_than_one = [](std::size_t n) { return n > 1; };
+    for (auto n : utilities::lines(file) | std::views::transform(n_tokens) | std::views::filter(more_than_one))
+        std::print("{} tokens\n", n);
+
+    return 0;
+}
@@ -0,0 +1,17 @@
+/// @brief Fill in the template variables in some text with a compiled multi_replacer.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+int
+main()
+{
+    // Compile the substitutions once & reuse them on every line.
+    utilities::multi_replacer fill{{"{name}", "Joan"}, {"{item}", "a bicycle"}, {"{when}", "Tuesday"}};
+
+    std::string x;
+    while (std::cout << "Text with {name}, {item}, or {when} in it (x to exit)? " && std::getline(std::cin, x)) {
+        if (x == "X" || x == "x") break;
+        std::print("'{}'\n", fill.replaced(x));
+    }
+    return 0;
+}
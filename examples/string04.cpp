@@ -0,0 +1,30 @@
+/// @brief Standardize a large batch of strings on several threads & check the results against a simple loop.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+#include <random>
+
+int
+main()
+{
+    // Make a pile of messy keys.
+    constexpr std::string_view parts[] = {"  ace ", "of", "\t clubs ", "(queen)", "[[ King ]]", "  "};
+    std::mt19937               gen{42};
+    std::vector<std::string>   keys(1'000'000);
+    for (auto& key : keys)
+        for (int i = 0; i < 4; ++i) key += parts[gen() % std::size(parts)];
+
+    utilities::stopwatch sw;
+    std::vector<std::string> serial = keys;
+    for (auto& key : serial) utilities::standardize(key);
+    sw.click();
+    std::print("Simple loop:      {}\n", sw);
+
+    auto batch = utilities::standardized_all(keys);
+    sw.click();
+    std::print("standardized_all: {}\n", sw);
+
+    auto same = std::ranges::equal(batch, serial);
+    std::print("{} strings & {} characters in the batch, results match: {}\n", batch.size(), batch.chars().size(), same);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+/// @brief Check a multi_replacer against a simple search loop on random inputs & time it on a nasty one.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+#include <random>
+
+// The slow but obvious version: at each step replace the earliest (and then longest) target found by `find`.
+// Ties go to the first target given, just as they do for the replacer.
+std::string
+simple_replaced(std::string_view input, const std::vector<std::pair<std::string, std::string>>& pairs)
+{
+    std::string retval;
+    std::size_t i = 0;
+    while (i < input.size()) {
+        std::size_t best_pos = std::string_view::npos, best_len = 0, best = 0;
+        for (std::size_t k = 0; k < pairs.size(); ++k) {
+            const auto& target = pairs[k].first;
+            if (target.empty()) continue;
+            auto pos = input.find(target, i);
+            if (pos < best_pos || (pos == best_pos && pos != std::string_view::npos && target.size() > best_len)) {
+                best_pos = pos;
+                best_len = target.size();
+                best = k;
+            }
+        }
+        if (best_pos == std::string_view::npos) break;
+        retval += input.substr(i, best_pos - i);
+        retval += pairs[best].second;
+        i = best_pos + best_len;
+    }
+    if (i < input.size()) retval += input.substr(i);
+    return retval;
+}
+
+int
+main()
+{
+    // Lots of small random sets of targets tried on lots of small random strings over a tiny alphabet.
+    std::mt19937 gen{42};
+    auto         random_string = [&](std::size_t n) {
+        std::string retval(n, ' ');
+        for (auto& c : retval) c = "abc"[gen() % 3];
+        return retval;
+    };
+    std::size_t trials = 0, failures = 0;
+    for (int t = 0; t < 20'000; ++t) {
+        std::vector<std::pair<std::string, std::string>> pairs;
+        for (std::size_t k = 0, n = 1 + gen() % 6; k < n; ++k)
+            pairs.emplace_back(random_string(gen() % 7), random_string(gen() % 4));
+
+        utilities::multi_replacer replacer{pairs};
+        for (int u = 0; u < 5; ++u, ++trials) {
+            auto input = random_string(gen() % 40);
+            if (replacer.replaced(input) != simple_replaced(input, pairs)) ++failures;
+        }
+    }
+    std::print("Random trials: {}, mismatches: {}\n", trials, failures);
+
+    // A short target plus a long one that keeps almost matching -- a search that backs up goes quadratic on this.
+    std::string               input(1'000'000, 'a');
+    utilities::multi_replacer nasty{{"a", "x"}, {std::string(2000, 'a') + "b", "y"}};
+    utilities::stopwatch      sw;
+    auto                      output = nasty.replaced(input);
+    sw.click();
+    auto same = output == std::string(input.size(), 'x');
+    std::print("Replaced {} characters with a 2001 character near miss target in {}, result correct: {}\n", input.size(),
+               sw, same);
+    return failures == 0 && same ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+/// @brief Record a trace timeline of a few threads & save it as a Chrome trace file.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/print.h"
+#include "utilities/profile.h"
+#include "utilities/trace.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+void
+stage(int ms)
+{
+    TRACE_FUNCTION();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void
+pipeline(int t)
+{
+    TRACE_SCOPE("pipeline");
+    for (int i = 0; i < 5; ++i) {
+        stage(1 + t);
+
+        // Profiling zones also show up on the timeline.
+        PROFILE_SCOPE("handoff");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int
+main()
+{
+    utilities::tracer::start();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) threads.emplace_back(pipeline, t);
+    for (auto& thread : threads) thread.join();
+    utilities::tracer::stop();
+
+    // Load the file into https://ui.perfetto.dev or chrome://tracing to see the timeline.
+    utilities::tracer::save("trace01.json");
+    std::print("Saved the trace timeline to 'trace01.json' ({} events dropped)\n", utilities::tracer::dropped());
+    return 0;
+}
@@ -0,0 +1,42 @@
+/// @brief Use the compile-time type hashes as case labels & the type names as template parameters.
+/// @copyright Copyright (c) 2024 Nessan Fitzmaurice
+#include "utilities/utilities.h"
+
+// A template parameterized by a fixed string.
+template<utilities::fixed_string Name>
+struct tagged {
+    static constexpr auto name = Name;
+};
+
+// Dispatch on a type hash as you might in a type-erased table.
+std::string_view
+describe(std::uint64_t hash)
+{
+    switch (hash) {
+        case utilities::type_hash<int>(): return "an int";
+        case utilities::type_hash<double>(): return "a double";
+        case utilities::type_hash<std::string>(): return "a string";
+        default: return "something else";
+    }
+}
+
+int
+main()
+{
+    std::print("Compiler: {}\n", COMPILER_NAME);
+
+    int         i = 42;
+    double      x = 3.14;
+    std::string s = "hello";
+    float       f = 1.5f;
+    std::print("i is {}\n", describe(utilities::type_hash(i)));
+    std::print("x is {}\n", describe(utilities::type_hash(x)));
+    std::print("s is {}\n", describe(utilities::type_hash(s)));
+    std::print("f is {}\n", describe(utilities::type_hash(f)));
+
+    using vec_tag = tagged<utilities::type_name<std::vector<int>>()>;
+    std::print("vec_tag::name is '{}' with {} characters\n", vec_tag::name, vec_tag::name.size());
+    std::print("type_hash<std::vector<int>>() = {:#018x}\n", utilities::type_hash<std::vector<int>>());
+
+    return 0;
+}
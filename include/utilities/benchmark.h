@@ -0,0 +1,329 @@
+/// @brief A small microbenchmark harness built on the `utilities::stopwatch` class.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "format.h"
+#include "stopwatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utilities {
+
+// --------------------------------------------------------------------------------------------------------------------
+// Optimisation barriers ...
+// --------------------------------------------------------------------------------------------------------------------
+
+/// @brief Forces the compiler to assume `value` is used so the code that computed it cannot be optimised away.
+template<typename T>
+inline void
+do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/// @brief Forces the compiler to assume `value` is both used and modified so it cannot be hoisted out of a loop.
+template<typename T>
+inline void
+do_not_optimize(T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    // GCC can reject "+r,m" as an impossible constraint (e.g. for a temporary that holds a constant) while clang
+    // tends to settle on the first alternative -- so each compiler gets the order that suits it.
+    if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*))
+    #ifdef __clang__
+        asm volatile("" : "+r,m"(value) : : "memory");
+    #else
+        asm volatile("" : "+m,r"(value) : : "memory");
+    #endif
+    else
+        asm volatile("" : "+m"(value) : : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/// @brief Forces the compiler to assume all memory may have been read and written so pending stores have to happen.
+inline void
+clobber_memory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// Benchmark results ...
+// --------------------------------------------------------------------------------------------------------------------
+
+/// @brief The statistics collected for one benchmarked callable. All times are in seconds per call.
+struct benchmark_result {
+    std::string name;                // The name of the benchmark.
+    std::size_t iterations = 0;      // The number of calls timed in each sample.
+    std::size_t samples = 0;         // The number of samples taken.
+    double      min = 0;             // Fastest sample.
+    double      median = 0;          // Median sample.
+    double      mean = 0;            // Mean over all the samples.
+    double      p99 = 0;             // 99th percentile sample.
+    double      stddev = 0;          // Standard deviation of the samples.
+    double      items_per_call = 0;  // If non-zero we report a throughput in items per second.
+    double      bytes_per_call = 0;  // If non-zero we report a throughput in bytes per second.
+
+    /// @brief Throughput in items per second based on the median time (zero if we don't know the items per call).
+    double items_per_second() const { return median > 0 ? items_per_call / median : 0; }
+
+    /// @brief Throughput in bytes per second based on the median time (zero if we don't know the bytes per call).
+    double bytes_per_second() const { return median > 0 ? bytes_per_call / median : 0; }
+
+    /// @brief Returns a one line summary e.g. "sort: median 1.23us, min 1.20us, mean 1.25us, p99 1.40us, ..."
+    std::string to_string() const
+    {
+        auto retval = std::format("{}: median {}, min {}, mean {}, p99 {}, stddev {}", name, duration_string(median),
+                                  duration_string(min), duration_string(mean), duration_string(p99),
+                                  duration_string(stddev));
+        if (items_per_call > 0) retval += std::format(", {} items/s", rate_string(items_per_second()));
+        if (bytes_per_call > 0) retval += std::format(", {}B/s", rate_string(bytes_per_second()));
+        return retval;
+    }
+
+    /// @brief Returns the result as a JSON object -- times are in seconds per call & rates are per second.
+    std::string to_json() const
+    {
+        std::string retval = "{\"name\":";
+        json_string_to(std::back_inserter(retval), name);
+        std::format_to(std::back_inserter(retval),
+                       ",\"iterations\":{},\"samples\":{},\"min\":{},\"median\":{},\"mean\":{},\"p99\":{},"
+                       "\"stddev\":{},\"items_per_call\":{},\"bytes_per_call\":{},\"items_per_second\":{},"
+                       "\"bytes_per_second\":{}}}",
+                       iterations, samples, min, median, mean, p99, stddev, items_per_call, bytes_per_call,
+                       items_per_second(), bytes_per_second());
+        return retval;
+    }
+
+    /// @brief Returns a rate as a string with a sensible magnitude suffix e.g. "1.23G".
+    static std::string rate_string(double rate)
+    {
+        if (rate >= 1e9) return std::format("{:.2f}G", rate / 1e9);
+        if (rate >= 1e6) return std::format("{:.2f}M", rate / 1e6);
+        if (rate >= 1e3) return std::format("{:.2f}K", rate / 1e3);
+        return std::format("{:.2f}", rate);
+    }
+};
+
+/// @brief Usual output operator.
+inline std::ostream&
+operator<<(std::ostream& os, const benchmark_result& rhs)
+{
+    return os << rhs.to_string();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// The benchmark runner ...
+// --------------------------------------------------------------------------------------------------------------------
+
+/// @brief Runs callables repeatedly and collects timing statistics for each.
+/// @note  Each run starts with a warmup period, then works out how many calls make up a sample long enough to time
+///        accurately, then times a number of those samples. Statistics are computed over the per-call sample times.
+/// @note  Every benchmark run is remembered & `to_string()` returns a table of all the results so far.
+template<typename Clock = std::chrono::high_resolution_clock>
+class benchmark {
+public:
+    /// @brief A benchmark can have a name that is used as the title of its results table.
+    explicit benchmark(const std::string& name = "") : m_name(name) {}
+
+    /// @brief Set how long in seconds to spend calling the callable before we start timing it (default 0.1s).
+    benchmark& warmup(double seconds)
+    {
+        m_warmup = seconds;
+        return *this;
+    }
+
+    /// @brief Set the target duration in seconds for each sample (default 0.01s).
+    benchmark& sample_time(double seconds)
+    {
+        m_sample_time = seconds;
+        return *this;
+    }
+
+    /// @brief Set the number of samples to take (default 50).
+    benchmark& samples(std::size_t n)
+    {
+        m_samples = std::max(n, std::size_t{1});
+        return *this;
+    }
+
+    /// @brief Set the number of items processed per call for the next runs -- we then report items per second.
+    benchmark& items(double per_call)
+    {
+        m_items = per_call;
+        return *this;
+    }
+
+    /// @brief Set the number of bytes processed per call for the next runs -- we then report bytes per second.
+    benchmark& bytes(double per_call)
+    {
+        m_bytes = per_call;
+        return *this;
+    }
+
+    /// @brief Benchmark a callable & return its statistics (which are also added to the table of results).
+    /// @note  If the callable returns a value we pass it through `do_not_optimize` so the work cannot be elided.
+    template<typename F>
+    benchmark_result run(const std::string& name, F&& f)
+    {
+        // Warm up caches, branch predictors, CPU frequency, etc.
+        stopwatch<Clock> sw;
+        while (sw.elapsed() < m_warmup) call(f);
+
+        // Find a number of calls that takes at least the target sample time.
+        std::size_t iterations = 1;
+        while (true) {
+            auto t = time(f, iterations);
+            if (t >= m_sample_time || iterations >= c_max_iterations) break;
+            auto scale = t > 0 ? 1.2 * m_sample_time / t : 10.0;
+            auto next = static_cast<std::size_t>(static_cast<double>(iterations) * std::clamp(scale, 1.5, 10.0));
+            iterations = std::min(next, c_max_iterations);
+        }
+
+        // Take the samples as seconds per call.
+        std::vector<double> times(m_samples);
+        for (auto& t : times) t = time(f, iterations) / static_cast<double>(iterations);
+        std::sort(times.begin(), times.end());
+
+        benchmark_result r;
+        r.name = name;
+        r.iterations = iterations;
+        r.samples = times.size();
+        r.min = times.front();
+        r.median = percentile(times, 0.50);
+        r.p99 = percentile(times, 0.99);
+        r.mean = std::accumulate(times.begin(), times.end(), 0.0) / static_cast<double>(times.size());
+        double ss = 0;
+        for (auto t : times) ss += (t - r.mean) * (t - r.mean);
+        r.stddev = times.size() > 1 ? std::sqrt(ss / static_cast<double>(times.size() - 1)) : 0;
+        r.items_per_call = m_items;
+        r.bytes_per_call = m_bytes;
+
+        m_results.push_back(r);
+        return r;
+    }
+
+    /// @brief Read-only access to the name of the benchmark.
+    const std::string& name() const { return m_name; }
+
+    /// @brief Read-only access to all the results so far.
+    const std::vector<benchmark_result>& results() const { return m_results; }
+
+    /// @brief Forget all the results so far.
+    void clear() { m_results.clear(); }
+
+    /// @brief Returns a table of all the results so far with one row per benchmark run.
+    std::string to_string() const
+    {
+        std::size_t width = 4;
+        for (const auto& r : m_results) width = std::max(width, r.name.size());
+
+        std::string retval;
+        if (!m_name.empty()) retval += std::format("{}\n", m_name);
+        retval += std::format("{:<{}}  {:>10}  {:>10}  {:>10}  {:>10}  {:>10}  {:>12}  {:>12}\n", "Name", width,
+                              "Median", "Min", "Mean", "P99", "StdDev", "Items/s", "Bytes/s");
+        for (const auto& r : m_results) {
+            auto items = r.items_per_call > 0 ? benchmark_result::rate_string(r.items_per_second()) : "-";
+            auto bytes = r.bytes_per_call > 0 ? benchmark_result::rate_string(r.bytes_per_second()) : "-";
+            retval += std::format("{:<{}}  {:>10}  {:>10}  {:>10}  {:>10}  {:>10}  {:>12}  {:>12}\n", r.name, width,
+                                  duration_string(r.median), duration_string(r.min), duration_string(r.mean),
+                                  duration_string(r.p99), duration_string(r.stddev), items, bytes);
+        }
+        return retval;
+    }
+
+    /// @brief Returns all the results so far as a JSON object with the name of the benchmark & an array of results.
+    /// @note  That is handy for saving results from one release & comparing them with those from the next.
+    std::string to_json() const
+    {
+        std::string retval = "{\"name\":";
+        json_string_to(std::back_inserter(retval), m_name);
+        retval += ",\"results\":[";
+        for (std::size_t i = 0; i < m_results.size(); ++i) {
+            if (i > 0) retval += ',';
+            retval += "\n";
+            retval += m_results[i].to_json();
+        }
+        retval += "\n]}";
+        return retval;
+    }
+
+private:
+    // Never time more than this many calls in one sample (guards against callables the compiler reduced to nothing).
+    static constexpr std::size_t c_max_iterations = std::size_t{1} << 30;
+
+    std::string                   m_name;               // Name of the benchmark used as the title of the table.
+    double                        m_warmup = 0.1;       // Seconds spent warming up before each run.
+    double                        m_sample_time = 0.01; // Target seconds for each sample.
+    std::size_t                   m_samples = 50;       // Number of samples taken in each run.
+    double                        m_items = 0;          // Items processed per call (zero if unknown).
+    double                        m_bytes = 0;          // Bytes processed per call (zero if unknown).
+    std::vector<benchmark_result> m_results;            // All the results so far.
+
+    // Call the callable once making sure any value it returns is treated as used.
+    template<typename F>
+    static void call(F& f)
+    {
+        if constexpr (std::is_void_v<std::invoke_result_t<F&>>) {
+            std::invoke(f);
+        }
+        else {
+            auto&& result = std::invoke(f);
+            do_not_optimize(result);
+        }
+    }
+
+    // Returns the time in seconds taken to call the callable n times.
+    template<typename F>
+    static double time(F& f, std::size_t n)
+    {
+        stopwatch<Clock> sw;
+        for (std::size_t i = 0; i < n; ++i) call(f);
+        return sw.elapsed();
+    }
+
+    // Nearest-rank percentile of some sorted values.
+    static double percentile(const std::vector<double>& sorted, double p)
+    {
+        auto rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        return sorted[std::clamp(rank, std::size_t{1}, sorted.size()) - 1];
+    }
+};
+
+/// @brief Usual output operator prints the table of results.
+template<typename Clock>
+inline std::ostream&
+operator<<(std::ostream& os, const benchmark<Clock>& rhs)
+{
+    return os << rhs.to_string();
+}
+
+} // namespace utilities
@@ -0,0 +1,309 @@
+/// @brief Read the CPU's hardware performance counters around blocks of code & a stopwatch that reports them per lap.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "stopwatch.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define UTILITIES_PERF_EVENTS
+#endif
+
+namespace utilities {
+
+/// @brief The hardware events we count.
+enum class perf_event : std::size_t { cycles, instructions, cache_misses, branch_misses };
+
+/// @brief Readings from a group of performance counters -- or the difference between two readings.
+/// @note  The four hardware counts tell you whether some code was slow because of the CPU (instructions per cycle,
+///        branch misses) or because of memory (cache misses). The number of context switches tells you whether the
+///        scheduler took the CPU away.
+struct perf_counts {
+    std::uint64_t cycles = 0;           // CPU cycles.
+    std::uint64_t instructions = 0;     // Instructions retired.
+    std::uint64_t cache_misses = 0;     // Last level cache misses.
+    std::uint64_t branch_misses = 0;    // Mispredicted branches.
+    std::uint64_t context_switches = 0; // Voluntary & involuntary context switches.
+
+    /// @brief Returns the number of instructions retired per cycle (zero if we have no cycle count).
+    constexpr double ipc() const
+    {
+        return cycles > 0 ? static_cast<double>(instructions) / static_cast<double>(cycles) : 0;
+    }
+
+    /// @brief The counts that happened between an earlier reading & this one.
+    friend constexpr perf_counts operator-(const perf_counts& lhs, const perf_counts& rhs)
+    {
+        return {lhs.cycles - rhs.cycles, lhs.instructions - rhs.instructions, lhs.cache_misses - rhs.cache_misses,
+                lhs.branch_misses - rhs.branch_misses, lhs.context_switches - rhs.context_switches};
+    }
+
+    /// @brief Adds another set of counts to this one (e.g. to total up the laps from several threads).
+    constexpr perf_counts& operator+=(const perf_counts& rhs)
+    {
+        cycles += rhs.cycles;
+        instructions += rhs.instructions;
+        cache_misses += rhs.cache_misses;
+        branch_misses += rhs.branch_misses;
+        context_switches += rhs.context_switches;
+        return *this;
+    }
+
+    /// @brief Get a string representation of the counts.
+    std::string to_string() const
+    {
+        std::string retval;
+        format_to(std::back_inserter(retval));
+        return retval;
+    }
+
+    /// @brief Writes the counts straight to an output iterator.
+    template<typename OutputIt>
+    OutputIt format_to(OutputIt out) const
+    {
+        return std::format_to(out,
+                              "cycles {}, instructions {} (IPC {:.2f}), cache misses {}, branch misses {}, "
+                              "context switches {}",
+                              cycles, instructions, ipc(), cache_misses, branch_misses, context_switches);
+    }
+};
+
+/// @brief Usual output operator.
+inline std::ostream&
+operator<<(std::ostream& os, const perf_counts& rhs)
+{
+    return os << rhs.to_string();
+}
+
+/// @brief A group of hardware performance counters for the calling thread that all start & stop together.
+/// @note  On Linux this opens the counters with `perf_event_open`, counting user space events for the thread that
+///        creates the object (read the counters on that thread too). The counters may not be there in a virtual
+///        machine or if `/proc/sys/kernel/perf_event_paranoid` is above 2 -- check `available()`. Any counters that
+///        are missing read as zero. If the kernel had to share the hardware between more events than it has counters
+///        then the readings are scaled up to estimate the full counts.
+/// @note  The context switch count comes from `getrusage` so that one is there even without any hardware counters.
+///        On other platforms everything reads as zero.
+class perf_counters {
+public:
+    /// @brief Opens & starts the counters.
+    perf_counters()
+    {
+        m_fds.fill(-1);
+#if defined(UTILITIES_PERF_EVENTS)
+        constexpr std::array<std::uint64_t, c_events> config = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                                 PERF_COUNT_HW_CACHE_MISSES,
+                                                                 PERF_COUNT_HW_BRANCH_MISSES};
+        for (std::size_t i = 0; i < c_events; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config[i];
+            attr.disabled = m_leader < 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            auto fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0));
+            if (fd < 0) continue;
+            if (ioctl(fd, PERF_EVENT_IOC_ID, &m_ids[i]) < 0) {
+                close(fd);
+                continue;
+            }
+            m_fds[i] = fd;
+            if (m_leader < 0) m_leader = fd;
+        }
+        if (m_leader >= 0) {
+            ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    ~perf_counters()
+    {
+#if defined(UTILITIES_PERF_EVENTS)
+        for (auto fd : m_fds)
+            if (fd >= 0) close(fd);
+#endif
+    }
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    /// @brief Check whether we got any of the hardware counters.
+    bool available() const { return m_leader >= 0; }
+
+    /// @brief Check whether we got a particular hardware counter.
+    bool available(perf_event event) const { return m_fds[static_cast<std::size_t>(event)] >= 0; }
+
+    /// @brief Returns the counts since the counters were opened -- subtract two readings to get the counts in between.
+    perf_counts read() const
+    {
+        perf_counts retval;
+#if defined(UTILITIES_PERF_EVENTS)
+        if (m_leader >= 0) {
+            struct {
+                std::uint64_t nr, time_enabled, time_running;
+                struct {
+                    std::uint64_t value, id;
+                } values[c_events];
+            } data{};
+            if (::read(m_leader, &data, sizeof(data)) > 0) {
+                auto scale = data.time_running > 0 && data.time_running < data.time_enabled
+                                 ? static_cast<double>(data.time_enabled) / static_cast<double>(data.time_running)
+                                 : 1.0;
+                for (std::size_t j = 0; j < std::min<std::size_t>(data.nr, c_events); ++j) {
+                    auto value = static_cast<std::uint64_t>(static_cast<double>(data.values[j].value) * scale);
+                    for (std::size_t i = 0; i < c_events; ++i)
+                        if (m_fds[i] >= 0 && m_ids[i] == data.values[j].id) count(retval, i) = value;
+                }
+            }
+        }
+        rusage usage{};
+        if (getrusage(RUSAGE_THREAD, &usage) == 0)
+            retval.context_switches = static_cast<std::uint64_t>(usage.ru_nvcsw + usage.ru_nivcsw);
+#endif
+        return retval;
+    }
+
+private:
+    static constexpr std::size_t c_events = 4;
+
+    std::array<int, c_events>           m_fds;        // The file descriptor for each counter (-1 if we didn't get it).
+    std::array<std::uint64_t, c_events> m_ids = {};   // The kernel's id for each counter.
+    int                                 m_leader = -1; // The counter that leads the group.
+
+    static std::uint64_t& count(perf_counts& counts, std::size_t i)
+    {
+        switch (static_cast<perf_event>(i)) {
+            case perf_event::cycles: return counts.cycles;
+            case perf_event::instructions: return counts.instructions;
+            case perf_event::cache_misses: return counts.cache_misses;
+            default: return counts.branch_misses;
+        }
+    }
+};
+
+/// @brief A stopwatch that also records the CPU time & the hardware performance counts for each lap.
+/// @note  Each `click()` reads the wall clock, the calling thread's CPU time clock, & the counters. From a slow lap you
+///        can then see whether the time went on the CPU (cycles & instructions per cycle), on memory (cache misses),
+///        or off the CPU altogether (the gap between the wall & CPU times & the context switches).
+/// @note  Create, click, & read a counting stopwatch on one thread -- the CPU time & the counters are for that thread.
+template<typename Clock = std::chrono::high_resolution_clock>
+class counting_stopwatch {
+public:
+    /// @brief The underlying clock type
+    using clock_type = Clock;
+
+    /// @brief A stopwatch can have a name to distinguish it from others you may have running
+    explicit counting_stopwatch(const std::string& str = "") : m_stopwatch(str) { reset(); }
+
+    /// @brief Read-only access to the stopwatch's name
+    std::string name() const { return m_stopwatch.name(); }
+
+    /// @brief Read-write access to the stopwatch's name
+    std::string& name() { return m_stopwatch.name(); }
+
+    /// @brief Set/reset the stopwatch's 'zero' point & clear any measured splits.
+    void reset()
+    {
+        m_stopwatch.reset();
+        m_cpu.reset();
+        m_zero = m_counters.read();
+        m_prior = m_zero;
+        m_split = m_zero;
+    }
+
+    /// @brief Get the wall time that has passed from the zero point to now. Units are seconds.
+    double elapsed() const { return m_stopwatch.elapsed(); }
+
+    /// @brief Clicks the stopwatch to create a new 'split'.
+    /// @return The elapsed wall time to the click in seconds.
+    double click()
+    {
+        auto retval = m_stopwatch.click();
+        m_cpu.click();
+        m_prior = m_split;
+        m_split = m_counters.read();
+        return retval;
+    }
+
+    /// @brief Returns the wall time in seconds from the zero point to the last click.
+    double split() const { return m_stopwatch.split(); }
+
+    /// @brief Returns the last 'lap' wall time in seconds (i.e. the time between prior 2 splits).
+    double lap() const { return m_stopwatch.lap(); }
+
+    /// @brief Returns the CPU time in seconds the thread used from the zero point to the last click.
+    double cpu_split() const { return m_cpu.split(); }
+
+    /// @brief Returns the CPU time in seconds the thread used in the last lap.
+    double cpu_lap() const { return m_cpu.lap(); }
+
+    /// @brief Returns the time in seconds the thread spent off the CPU (preempted, blocked, asleep) in the last lap.
+    double off_cpu_lap() const { return std::max(lap() - cpu_lap(), 0.0); }
+
+    /// @brief Returns the performance counts from the zero point to the last click.
+    perf_counts split_counts() const { return m_split - m_zero; }
+
+    /// @brief Returns the performance counts for the last lap.
+    perf_counts lap_counts() const { return m_split - m_prior; }
+
+    /// @brief Read-only access to the underlying counters (e.g. to check which ones are available).
+    const perf_counters& counters() const { return m_counters; }
+
+    /// @brief Get a string representation of the last lap.
+    std::string to_string() const
+    {
+        std::string retval;
+        format_to(std::back_inserter(retval));
+        return retval;
+    }
+
+    /// @brief Writes the stopwatch's name (if any) & the details of the last lap straight to an output iterator.
+    template<typename OutputIt>
+    OutputIt format_to(OutputIt out) const
+    {
+        if (!name().empty()) out = std::format_to(out, "{}: ", name());
+        out = std::format_to(out, "lap {} (cpu {}, off cpu {}), ", duration_string(lap()), duration_string(cpu_lap()),
+                             duration_string(off_cpu_lap()));
+        if (!m_counters.available()) {
+            return std::format_to(out, "context switches {} (no hardware counters)", lap_counts().context_switches);
+        }
+        return lap_counts().format_to(out);
+    }
+
+private:
+    stopwatch<Clock>     m_stopwatch; // The wall time.
+    thread_cpu_stopwatch m_cpu;       // The thread's CPU time.
+    perf_counters        m_counters;  // The hardware counters.
+    perf_counts          m_zero;      // The counts at the zero point.
+    perf_counts          m_prior;     // The counts at the prior click.
+    perf_counts          m_split;     // The counts at the last click.
+};
+
+/// @brief Usual output operator. Prints the name of the stopwatch if any followed by the details of the last lap.
+template<typename Clock>
+inline std::ostream&
+operator<<(std::ostream& os, const counting_stopwatch<Clock>& rhs)
+{
+    return os << rhs.to_string();
+}
+
+} // namespace utilities
@@ -8,6 +8,8 @@
 #include <concepts>
 #include <format>
 #include <cassert>
+#include <iterator>
+#include <string>
 
 /// @brief A concept that matches any type that has an accessible `std::string to_string() const` method.
 template<typename T>
@@ -15,8 +17,35 @@ concept has_to_string_method = requires(const T& x) {
     { x.to_string() } -> std::convertible_to<std::string>;
 };
 
+/// @brief A concept that matches any type with an accessible `OutputIt format_to(OutputIt) const` method.
+/// @note  Types like that can write themselves straight into the output of `std::format` -- no temporary strings.
+template<typename T>
+concept has_format_to_method = requires(const T& x, std::back_insert_iterator<std::string> out) {
+    { x.format_to(out) } -> std::same_as<std::back_insert_iterator<std::string>>;
+};
+
+/// @brief Connect any type that has an accessible `OutputIt format_to(OutputIt) const` method to `std::format`.
+/// @note  This is preferred to the `to_string()` version below as nothing is built up in a temporary string first.
+template<has_format_to_method T>
+struct std::formatter<T> {
+    template<class FormatContext>
+    auto format(const T& rhs, FormatContext& ctx) const
+    {
+        return rhs.format_to(ctx.out());
+    }
+
+    constexpr auto parse(const std::format_parse_context& ctx)
+    {
+        // Throw an error for anything that is not default formatted.
+        auto it = ctx.begin();
+        assert(it == ctx.end() || *it == '}');
+        return it;
+    }
+};
+
 /// @brief Connect any type that has an accessible `std::string to_string() const` method to `std::format
 template<has_to_string_method T>
+    requires(!has_format_to_method<T>)
 struct std::formatter<T> {
     template<class FormatContext>
     auto format(const T& rhs, FormatContext& ctx) const
@@ -40,7 +69,12 @@ struct std::formatter<T> {
 // --------------------------------------------------------------------------------------------------------------------
 #ifndef __cpp_lib_format_ranges
 
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
 #include <ranges>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 
 namespace utilities {
@@ -59,11 +93,38 @@ template <typename T>
 		is_char<std::ranges::range_value_t<T>>			    // is a range of characters
 			&& (!requires { typename T::value_type; }		// that is either not a container (has no value_type member)
 				|| requires { typename T::traits_type; });	// or a std::basic_string<> (has a traits_type member)
+
+/// @brief Writes a string to an output iterator as a quoted JSON string with the usual escapes.
+/// @return The output iterator just past the closing quote.
+template<std::output_iterator<char> OutputIt>
+OutputIt
+json_string_to(OutputIt out, std::string_view str)
+{
+    *out++ = '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            *out++ = '\\';
+            *out++ = c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            out = std::format_to(out, "\\u{:04x}", static_cast<unsigned>(c));
+        }
+        else {
+            *out++ = c;
+        }
+    }
+    *out++ = '"';
+    return out;
+}
 } // namespace utilities
 
 /// @brief A formatter for a std::range (but deliberately excluding strings which already handled by std::format).
 /// @note  By default arrays are printed [a0, a1, a3, ...]
 /// @note  You can suppress the '[' & ']' delimiters by adding a 'n' to the format spec.
+/// @note  You can limit the number of elements printed by adding a count to the format spec. For example, `{:6}`
+///        prints a vector of 100 elements as [a0, a1, a2, ..., a97, a98, a99].
+/// @note  Ranges of numbers with no element format spec are written with `std::to_chars` in blocks on the stack
+///        rather than one element & one character at a time through the element formatter.
 template<std::ranges::input_range T>
     requires(!utilities::is_string<T>)
 struct std::formatter<T> : public std::formatter<std::ranges::range_value_t<T>> {
@@ -72,12 +133,16 @@ struct std::formatter<T> : public std::formatter<std::ranges::range_value_t<T>>
         auto pos = ctx.begin();
         while (pos != ctx.end() && *pos != '}') {
             if (*pos == ':') {
+                m_plain = false;
                 ctx.advance_to(++pos);
                 return std::formatter<std::ranges::range_value_t<T>>::parse(ctx);
             }
             else if (*pos == 'n') {
                 m_surround = false;
             }
+            else if (*pos >= '0' && *pos <= '9') {
+                m_limit = 10 * m_limit + static_cast<std::size_t>(*pos - '0');
+            }
             ++pos;
         }
         return pos;
@@ -86,25 +151,112 @@ struct std::formatter<T> : public std::formatter<std::ranges::range_value_t<T>>
     template<class FormatContext>
     auto format(const T& range, FormatContext& ctx) const
     {
-        auto pos = ctx.out();
-        if (m_surround) {
-            *pos++ = '[';
-            ctx.advance_to(pos);
+        if constexpr (c_numeric) {
+            if (m_plain) return format_numbers(range, ctx);
         }
-        bool sep = false;
-        for (auto&& value : range) {
-            if (std::exchange(sep, true)) {
+        auto pos = ctx.out();
+        if (m_surround) *pos++ = '[';
+        for_each_shown(
+            range,
+            [this, &pos, &ctx](const auto& value) {
+                ctx.advance_to(pos);
+                pos = this->std::formatter<std::ranges::range_value_t<T>>::format(value, ctx);
+            },
+            [&] {
                 *pos++ = ',';
                 *pos++ = ' ';
-            }
-            pos = std::formatter<std::ranges::range_value_t<T>>::format(value, ctx);
-            ctx.advance_to(pos);
-        }
+            },
+            [&] { pos = std::fill_n(pos, 3, '.'); });
         if (m_surround) *pos++ = ']';
         return pos;
     }
 
-    bool m_surround = true;
+    bool        m_surround = true;
+    bool        m_plain = true; // No element format spec was given.
+    std::size_t m_limit = 0;    // The most elements to print (0 means no limit).
+
+private:
+    using value_type = std::ranges::range_value_t<T>;
+
+    // Ranges of these get the fast path -- we exclude bools & characters which are not formatted as numbers.
+    static constexpr bool c_numeric =
+        std::is_arithmetic_v<value_type> && !std::is_same_v<value_type, bool> && !utilities::is_char<value_type>;
+
+    // Calls `value(x)` for each element we show with `sep()` between them & `gap()` where elements are left out.
+    // For sized ranges we show elements from both ends, otherwise we show the first few.
+    template<typename Value, typename Sep, typename Gap>
+    void for_each_shown(const T& range, Value value, Sep sep, Gap gap) const
+    {
+        std::size_t i = 0;
+        if constexpr (std::ranges::sized_range<const T>) {
+            auto n = static_cast<std::size_t>(std::ranges::size(range));
+            if (m_limit > 0 && n > m_limit) {
+                auto head = (m_limit + 1) / 2, tail = m_limit / 2;
+                auto it = std::ranges::begin(range);
+                for (; i < head; ++i, ++it) {
+                    if (i > 0) sep();
+                    value(*it);
+                }
+                sep();
+                gap();
+                std::ranges::advance(it, static_cast<std::ranges::range_difference_t<const T>>(n - head - tail));
+                for (i = 0; i < tail; ++i, ++it) {
+                    sep();
+                    value(*it);
+                }
+                return;
+            }
+        }
+        for (auto&& x : range) {
+            if (m_limit > 0 && i == m_limit) {
+                sep();
+                gap();
+                return;
+            }
+            if (i++ > 0) sep();
+            value(x);
+        }
+    }
+
+    // The fast path for ranges of numbers with no element format spec (which means `std::to_chars` gives the same
+    // output as `std::format`). We write into a block on the stack & hand each full block over as a single string
+    // (which the formatting library can copy in bulk rather than one character at a time).
+    template<class FormatContext>
+    auto format_numbers(const T& range, FormatContext& ctx) const
+    {
+        constexpr std::size_t block_size = 4096;
+        constexpr std::size_t most_chars = 64; // Enough for any number in the shortest round trip form.
+
+        char        block[block_size];
+        std::size_t n = 0;
+        auto        out = ctx.out();
+        auto        room = [&](std::size_t count) {
+            if (n + count > block_size) {
+                out = std::format_to(out, "{}", std::string_view{block, n});
+                n = 0;
+            }
+        };
+
+        if (m_surround) block[n++] = '[';
+        for_each_shown(
+            range,
+            [&](value_type x) {
+                room(most_chars);
+                n = static_cast<std::size_t>(std::to_chars(block + n, block + block_size, x).ptr - block);
+            },
+            [&] {
+                room(2);
+                block[n++] = ',';
+                block[n++] = ' ';
+            },
+            [&] {
+                room(3);
+                for (int i = 0; i < 3; ++i) block[n++] = '.';
+            });
+        room(1);
+        if (m_surround) block[n++] = ']';
+        return std::format_to(out, "{}", std::string_view{block, n});
+    }
 };
 
 #endif // End of #ifndef __cpp_lib_format_ranges block.
\ No newline at end of file
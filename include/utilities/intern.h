@@ -0,0 +1,307 @@
+/// @brief Intern strings as small, stable handles that compare & hash in constant time.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "format.h"
+#include "string.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utilities {
+
+/// @brief An append-only arena for the bytes of strings -- once stored a string never moves until the arena dies.
+/// @note  Small strings are packed one after another into largish blocks. Big strings get a block of their own.
+class string_arena {
+public:
+    explicit string_arena(std::size_t block_size = 64 * 1024) : m_block_size{std::max(block_size, std::size_t{1})} {}
+
+    string_arena(const string_arena&) = delete;
+    string_arena& operator=(const string_arena&) = delete;
+
+    /// @brief Copies a string into the arena & returns a view of the copy which stays valid for the arena's lifetime.
+    std::string_view store(std::string_view str)
+    {
+        auto n = str.size();
+        if (n == 0) return {};
+
+        char* dst;
+        if (n <= m_room) {
+            dst = m_next;
+            m_next += n;
+            m_room -= n;
+        }
+        else if (n > m_block_size / 2) {
+            dst = allocate(n);
+        }
+        else {
+            dst = allocate(m_block_size);
+            m_next = dst + n;
+            m_room = m_block_size - n;
+        }
+        std::memcpy(dst, str.data(), n);
+        m_bytes += n;
+        return {dst, n};
+    }
+
+    /// @brief The total number of bytes stored so far.
+    std::size_t bytes() const { return m_bytes; }
+
+    /// @brief The number of blocks allocated so far.
+    std::size_t blocks() const { return m_blocks.size(); }
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_blocks;     // All the blocks allocated so far.
+    std::size_t                          m_block_size; // The size of the blocks we pack small strings into.
+    char*                                m_next = nullptr;
+    std::size_t                          m_room = 0;  // The room left in the current block.
+    std::size_t                          m_bytes = 0; // Bytes stored.
+
+    char* allocate(std::size_t n)
+    {
+        m_blocks.push_back(std::make_unique_for_overwrite<char[]>(n));
+        return m_blocks.back().get();
+    }
+};
+
+/// @brief A handle for an interned string -- two symbols from the same table are equal iff their strings are equal.
+/// @note  A symbol is just a pointer so it is cheap to copy, compares in constant time, & hashes to the hash of its
+///        string which is computed once when the string is interned. A default constructed symbol is "null".
+class symbol {
+public:
+    constexpr symbol() = default;
+
+    /// @brief A view of the interned string (empty for a null symbol). This stays valid for the table's lifetime.
+    constexpr std::string_view view() const { return m_entry ? m_entry->text : std::string_view{}; }
+
+    /// @brief A copy of the interned string.
+    std::string to_string() const { return std::string{view()}; }
+
+    /// @brief The small integer id of the symbol in its table -- ids run from 0 to the size of the table less one.
+    /// @note  A null symbol has id `symbol::npos`.
+    constexpr std::size_t id() const { return m_entry ? m_entry->id : npos; }
+
+    /// @brief The hash of the interned string (zero for a null symbol).
+    constexpr std::size_t hash() const { return m_entry ? m_entry->hash : 0; }
+
+    /// @brief Check whether this is a real symbol as opposed to a null one.
+    constexpr explicit operator bool() const { return m_entry != nullptr; }
+
+    /// @brief Symbols are equal if they are for the same entry (which means they are from the same table).
+    friend constexpr bool operator==(const symbol&, const symbol&) = default;
+
+    /// @brief Symbols are ordered by their ids (which is not the same as the order of their strings).
+    /// @note  Symbols from different tables can share an id so ties are broken by entry address to stay consistent
+    ///        with `==`. That tie-break is arbitrary though -- the order is only meaningful within one table.
+    friend constexpr std::strong_ordering operator<=>(const symbol& lhs, const symbol& rhs)
+    {
+        if (auto cmp = lhs.id() <=> rhs.id(); std::is_neq(cmp)) return cmp;
+        return std::compare_three_way{}(lhs.m_entry, rhs.m_entry);
+    }
+
+    /// @brief The id of the null symbol.
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+private:
+    friend class intern_table;
+
+    struct entry {
+        std::string_view text; // The interned string which lives in the table's arena.
+        std::size_t      hash; // The hash of the string.
+        std::size_t      id;   // The id of the string in its table.
+    };
+    const entry* m_entry = nullptr;
+
+    constexpr explicit symbol(const entry* e) : m_entry{e} {}
+};
+
+/// @brief Usual output operator prints the interned string.
+inline std::ostream&
+operator<<(std::ostream& os, const symbol& rhs)
+{
+    return os << rhs.view();
+}
+
+/// @brief A table of interned strings that is safe to use from many threads at once.
+/// @note  The table is split into stripes by hash & each stripe has its own reader/writer lock, arena, & open
+///        addressing index. Looking up a string that is already there only takes a shared lock on its stripe so
+///        concurrent lookups never block one another. Strings are never removed so symbols stay valid as long as the
+///        table does.
+class intern_table {
+public:
+    intern_table() = default;
+
+    intern_table(const intern_table&) = delete;
+    intern_table& operator=(const intern_table&) = delete;
+
+    /// @brief Returns the symbol for a string -- adding the string to the table if it isn't there already.
+    symbol intern(std::string_view str)
+    {
+        auto  h = std::hash<std::string_view>{}(str);
+        auto& s = stripe_for(h);
+        {
+            std::shared_lock lock{s.mutex};
+            if (auto e = s.find(str, h)) return symbol{e};
+        }
+        std::unique_lock lock{s.mutex};
+        if (auto e = s.find(str, h)) return symbol{e};
+        auto& e = s.entries.emplace_back(s.arena.store(str), h, m_size.fetch_add(1, std::memory_order_relaxed));
+        s.insert(&e);
+        return symbol{&e};
+    }
+
+    /// @brief Returns the symbol for a string if it is in the table -- otherwise a null symbol.
+    symbol find(std::string_view str) const
+    {
+        auto             h = std::hash<std::string_view>{}(str);
+        auto&            s = stripe_for(h);
+        std::shared_lock lock{s.mutex};
+        return symbol{s.find(str, h)};
+    }
+
+    /// @brief Returns the symbol for the `standardized` version of a string -- adding that to the table if need be.
+    /// @note  Each thread keeps a small cache of raw strings it has seen recently & the symbols they standardized to.
+    ///        A hit costs one hash & one string comparison with no allocation & no locking. A miss standardizes the
+    ///        string into a reused thread local buffer before interning it.
+    symbol intern_standardized(std::string_view str)
+    {
+        struct cached {
+            std::size_t table = 0;
+            std::string raw;
+            symbol      sym;
+        };
+        thread_local std::array<cached, c_cache_size> cache;
+        thread_local std::string                      scratch;
+
+        auto& slot = cache[std::hash<std::string_view>{}(str) & (c_cache_size - 1)];
+        if (slot.table == m_serial && slot.raw == str) return slot.sym;
+
+        scratch.assign(str);
+        standardize(scratch);
+        slot.table = m_serial;
+        slot.raw.assign(str);
+        slot.sym = intern(scratch);
+        return slot.sym;
+    }
+
+    /// @brief The number of strings in the table.
+    std::size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+    /// @brief The number of bytes used to store the strings in the table.
+    std::size_t bytes() const
+    {
+        std::size_t retval = 0;
+        for (auto& s : m_stripes) {
+            std::shared_lock lock{s.mutex};
+            retval += s.arena.bytes();
+        }
+        return retval;
+    }
+
+    /// @brief Class method that returns the table used by the free `intern` & `intern_standardized` functions.
+    static intern_table& shared()
+    {
+        static intern_table retval;
+        return retval;
+    }
+
+private:
+    static constexpr std::size_t c_stripe_bits = 4;
+    static constexpr std::size_t c_stripes = std::size_t{1} << c_stripe_bits;
+    static constexpr std::size_t c_cache_size = 256;
+
+    // Each stripe is on its own cache line(s) so that threads working on different stripes don't get in each other's
+    // way.
+    struct alignas(64) stripe {
+        mutable std::shared_mutex         mutex;
+        string_arena                      arena;
+        std::deque<symbol::entry>         entries; // Stable addresses as we only ever append.
+        std::vector<const symbol::entry*> slots;   // Open addressing index that is never more than half full.
+
+        const symbol::entry* find(std::string_view str, std::size_t h) const
+        {
+            if (slots.empty()) return nullptr;
+            auto mask = slots.size() - 1;
+            for (auto i = h & mask; slots[i] != nullptr; i = (i + 1) & mask) {
+                if (slots[i]->hash == h && slots[i]->text == str) return slots[i];
+            }
+            return nullptr;
+        }
+
+        void insert(const symbol::entry* e)
+        {
+            if (2 * (entries.size() + 1) > slots.size()) {
+                slots.assign(std::max(slots.size() * 2, std::size_t{64}), nullptr);
+                for (const auto& old : entries)
+                    if (&old != e) place(&old);
+            }
+            place(e);
+        }
+
+        void place(const symbol::entry* e)
+        {
+            auto mask = slots.size() - 1;
+            auto i = e->hash & mask;
+            while (slots[i] != nullptr) i = (i + 1) & mask;
+            slots[i] = e;
+        }
+    };
+
+    std::array<stripe, c_stripes> m_stripes;
+    std::atomic<std::size_t>      m_size = 0;
+    std::size_t                   m_serial = next_serial(); // Tells the thread local caches which table they hold.
+
+    // Every table gets its own serial number (a fresh table can easily reuse the address of one that was destroyed).
+    static std::size_t next_serial()
+    {
+        static std::atomic<std::size_t> retval = 0;
+        return ++retval;
+    }
+
+    // The stripe is picked using the high bits of the hash so it is independent of the slot in the stripe's index.
+    stripe& stripe_for(std::size_t h) { return m_stripes[stripe_index(h)]; }
+    const stripe& stripe_for(std::size_t h) const { return m_stripes[stripe_index(h)]; }
+    static constexpr std::size_t stripe_index(std::size_t h)
+    {
+        return static_cast<std::size_t>((std::uint64_t{h} * 0x9E3779B97F4A7C15ull) >> (64 - c_stripe_bits));
+    }
+};
+
+/// @brief Returns the symbol for a string in the shared table -- adding the string to the table if need be.
+inline symbol
+intern(std::string_view str)
+{
+    return intern_table::shared().intern(str);
+}
+
+/// @brief Returns the symbol for the `standardized` version of a string in the shared table.
+/// @note  For example, "[ ace of  clubs ]" and "Ace of Clubs" both give the symbol for "ACE OF CLUBS".
+inline symbol
+intern_standardized(std::string_view str)
+{
+    return intern_table::shared().intern_standardized(str);
+}
+
+} // namespace utilities
+
+/// @brief A symbol hashes to the hash of its string which was computed, once, when the string was interned.
+template<>
+struct std::hash<utilities::symbol> {
+    std::size_t operator()(const utilities::symbol& s) const noexcept { return s.hash(); }
+};
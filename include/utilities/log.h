@@ -4,30 +4,375 @@
 /// SPDX-License-Identifier: MIT
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <format>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
 #include <string>
-#include <format>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// @brief The compile-time log levels -- set LOG_LEVEL to one of these to remove all messages below that level.
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+
+/// @brief By default, no messages are removed at compile time.
+#ifndef LOG_LEVEL
+    #define LOG_LEVEL LOG_LEVEL_TRACE
+#endif
+
+/// @brief Create and dispatch a message if its level is at or above the runtime threshold.
+/// @note  That check happens before any payload arguments are evaluated, let alone formatted.
+#define LOG_AT_LEVEL(level, type, ...) \
+    (utilities::message::enabled(level) ? MAKE_MESSAGE(type, __VA_ARGS__).dispatch() : void(0))
 
 /// @brief Create and dispatch a debug messages -- only ever printed if the DEBUG flag is set at compile time.
-#ifdef DEBUG
-    #define DBG(...) MAKE_MESSAGE("DBG", __VA_ARGS__).dispatch()
+#if defined(DEBUG) && LOG_LEVEL <= LOG_LEVEL_DEBUG
+    #define DBG(...) LOG_AT_LEVEL(utilities::log_level::debug, "DBG", __VA_ARGS__)
 #else
     #define DBG(...) void(0)
 #endif
 
 /// @brief Create and dispatch a log message. Can be turned off by setting NO_LOGS at compile time.
-#ifndef NO_LOGS
-    #define LOG(...) MAKE_MESSAGE("LOG", __VA_ARGS__).dispatch()
+#if !defined(NO_LOGS) && LOG_LEVEL <= LOG_LEVEL_INFO
+    #define LOG(...) LOG_AT_LEVEL(utilities::log_level::info, "LOG", __VA_ARGS__)
 #else
     #define LOG(...) void(0)
 #endif
 
+/// @brief Create and dispatch messages with an explicit severity. These are also turned off by setting NO_LOGS.
+#if !defined(NO_LOGS) && LOG_LEVEL <= LOG_LEVEL_TRACE
+    #define LOG_TRACE(...) LOG_AT_LEVEL(utilities::log_level::trace, "TRACE", __VA_ARGS__)
+#else
+    #define LOG_TRACE(...) void(0)
+#endif
+#if !defined(NO_LOGS) && LOG_LEVEL <= LOG_LEVEL_DEBUG
+    #define LOG_DEBUG(...) LOG_AT_LEVEL(utilities::log_level::debug, "DEBUG", __VA_ARGS__)
+#else
+    #define LOG_DEBUG(...) void(0)
+#endif
+#if !defined(NO_LOGS) && LOG_LEVEL <= LOG_LEVEL_INFO
+    #define LOG_INFO(...) LOG_AT_LEVEL(utilities::log_level::info, "INFO", __VA_ARGS__)
+#else
+    #define LOG_INFO(...) void(0)
+#endif
+#if !defined(NO_LOGS) && LOG_LEVEL <= LOG_LEVEL_WARN
+    #define LOG_WARN(...) LOG_AT_LEVEL(utilities::log_level::warn, "WARN", __VA_ARGS__)
+#else
+    #define LOG_WARN(...) void(0)
+#endif
+#if !defined(NO_LOGS) && LOG_LEVEL <= LOG_LEVEL_ERROR
+    #define LOG_ERROR(...) LOG_AT_LEVEL(utilities::log_level::error, "ERROR", __VA_ARGS__)
+#else
+    #define LOG_ERROR(...) void(0)
+#endif
+
+/// @brief Rate limited versions of `LOG` -- each call site gets its own `utilities::log_sampler`.
+/// @note  The sampler is checked before any payload arguments are evaluated, let alone formatted. When a message does
+///        get through it reports how many messages from that call site were suppressed since the last one.
+#define LOG_SAMPLED(level, type, test, ...)                                                                            \
+    do {                                                                                                               \
+        static utilities::log_sampler utilities_log_sampler;                                                           \
+        if (utilities::message::enabled(level)) {                                                                      \
+            if (auto utilities_log_suppressed = utilities_log_sampler.test)                                            \
+                MAKE_MESSAGE(type, __VA_ARGS__).suppressed(*utilities_log_suppressed).dispatch();                      \
+        }                                                                                                              \
+    } while (false)
+
+/// @brief Log every n'th message from a call site (starting with the first), first n messages, or one every so often.
+#if !defined(NO_LOGS) && LOG_LEVEL <= LOG_LEVEL_INFO
+    #define LOG_EVERY_N(n, ...) LOG_SAMPLED(utilities::log_level::info, "LOG", every_n(n), __VA_ARGS__)
+    #define LOG_FIRST_N(n, ...) LOG_SAMPLED(utilities::log_level::info, "LOG", first_n(n), __VA_ARGS__)
+    #define LOG_EVERY_T(seconds, ...) LOG_SAMPLED(utilities::log_level::info, "LOG", every_t(seconds), __VA_ARGS__)
+#else
+    #define LOG_EVERY_N(n, ...) void(0)
+    #define LOG_FIRST_N(n, ...) void(0)
+    #define LOG_EVERY_T(seconds, ...) void(0)
+#endif
+
 /// @brief Messages (instances of the `utilities::message` class below) are constructed using the MAKE_MESSAGE macro.
+/// @note  The location information all lives in static storage and the filename is extracted at compile time.
 #define MAKE_MESSAGE(type, ...) \
-    utilities::message { __func__, __FILE__, __LINE__, type __VA_OPT__(, std::format(__VA_ARGS__)) }
+    utilities::message::make(__func__, utilities::message::basename(__FILE__), __LINE__, type __VA_OPT__(, __VA_ARGS__))
 
 namespace utilities {
 
+/// @brief The severity levels for messages (these match the compile-time LOG_LEVEL_XXX values above).
+enum class log_level : int {
+    trace = LOG_LEVEL_TRACE,
+    debug = LOG_LEVEL_DEBUG,
+    info = LOG_LEVEL_INFO,
+    warn = LOG_LEVEL_WARN,
+    error = LOG_LEVEL_ERROR
+};
+
+/// @brief What the asynchronous message handler does if its queue of pending messages is full.
+enum class overflow_policy {
+    block,       // The producing thread waits until there is room in the queue.
+    drop_newest, // The new message is discarded.
+    drop_oldest  // The oldest pending message is discarded to make room for the new one.
+};
+
+/// @brief Decides whether a rate limited message from one call site gets through (see the `LOG_EVERY_N` etc. macros).
+/// @note  Each method returns the number of messages suppressed since the last one that got through or `std::nullopt`
+///        if this one should be skipped. Everything is lock-free so call sites can be hit from many threads at once.
+class log_sampler {
+public:
+    /// @brief Let through the first message and every n'th one after that.
+    std::optional<std::size_t> every_n(std::size_t n)
+    {
+        if (n <= 1) return 0;
+        auto count = m_count.fetch_add(1, std::memory_order_relaxed);
+        if (count % n != 0) return std::nullopt;
+        return count == 0 ? 0 : n - 1;
+    }
+
+    /// @brief Let through the first n messages and nothing after that.
+    std::optional<std::size_t> first_n(std::size_t n)
+    {
+        // Once we are past the limit we stop writing to the shared counter altogether.
+        if (m_count.load(std::memory_order_relaxed) >= n) return std::nullopt;
+        if (m_count.fetch_add(1, std::memory_order_relaxed) >= n) return std::nullopt;
+        return 0;
+    }
+
+    /// @brief Let through at most one message every so many seconds.
+    std::optional<std::size_t> every_t(double seconds)
+    {
+        using clock = std::chrono::steady_clock;
+        auto now = clock::now().time_since_epoch().count();
+        auto next = m_next.load(std::memory_order_relaxed);
+        if (now >= next) {
+            auto interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+            if (m_next.compare_exchange_strong(next, now + interval.count(), std::memory_order_relaxed))
+                return m_count.exchange(0, std::memory_order_relaxed);
+        }
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+private:
+    std::atomic<std::size_t>                      m_count = 0; // Messages seen (for `every_t` those suppressed).
+    std::atomic<std::chrono::steady_clock::rep> m_next = 0;  // For `every_t` the earliest tick a message can get out.
+};
+
+/// @brief Specialise this as `std::true_type` to let deferred payloads capture bitwise copies of one of your own types.
+/// @note  Only do that for trivially copyable types that are self-contained -- no pointers, references, spans, or views
+///        -- as the copy may well be formatted on another thread after whatever it pointed at is gone.
+template<typename T>
+struct is_deferrable : std::false_type {};
+
+/// @brief A message payload that has not been formatted yet: a format string plus bitwise copies of its arguments.
+/// @note  The arguments are copied into a small fixed-size buffer & formatting only happens if `to_string()` is called.
+///        That might be on the asynchronous writer thread or it might never happen if a handler discards the message.
+class deferred_payload {
+    // Helper functions that work out the layout of the arguments in the buffer (needed by `can_capture` below).
+    template<typename T>
+    static constexpr std::size_t align_up(std::size_t offset)
+    {
+        return (offset + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
+
+    // The offsets of each argument in the buffer (each one is suitably aligned).
+    template<typename... Args>
+    static constexpr std::array<std::size_t, sizeof...(Args)> offsets_for()
+    {
+        std::array<std::size_t, sizeof...(Args)> retval{};
+        std::size_t                               offset = 0, i = 0;
+        ((offset = align_up<Args>(offset), retval[i++] = offset, offset += sizeof(Args)), ...);
+        return retval;
+    }
+
+    // The number of bytes needed to hold all the arguments.
+    template<typename... Args>
+    static constexpr std::size_t size()
+    {
+        std::size_t offset = 0;
+        ((offset = align_up<Args>(offset) + sizeof(Args)), ...);
+        return offset;
+    }
+
+public:
+    /// @brief The number of bytes available to hold copies of the arguments.
+    static constexpr std::size_t capacity = 64;
+
+    /// @brief An argument can be captured if a bitwise copy is self-contained -- so no pointers, strings or views.
+    /// @note  That means arithmetic values, enums, & any trivially copyable types that opt in via `is_deferrable`.
+    template<typename T>
+    static constexpr bool capturable = std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                                       (is_deferrable<T>::value && std::is_trivially_copyable_v<T>);
+
+    /// @brief Can a payload with these arguments be deferred? They must all be capturable and fit in the buffer.
+    template<typename... Args>
+    static constexpr bool can_capture =
+        (capturable<std::remove_cvref_t<Args>> && ...) && size<std::remove_cvref_t<Args>...>() <= capacity;
+
+    /// @brief A default payload is empty.
+    deferred_payload() = default;
+
+    /// @brief Capture a format string (which must have static storage duration) and copies of its arguments.
+    template<typename... Args>
+        requires can_capture<Args...>
+    explicit deferred_payload(std::string_view fmt, const Args&... args) :
+        m_format{fmt}, m_render{render<std::remove_cvref_t<Args>...>}
+    {
+        [[maybe_unused]] constexpr auto offsets = offsets_for<std::remove_cvref_t<Args>...>();
+        [[maybe_unused]] std::size_t    i = 0;
+        ((std::memcpy(m_args.data() + offsets[i++], &args, sizeof(args))), ...);
+    }
+
+    /// @brief Is there anything here?
+    constexpr bool empty() const { return m_render == nullptr; }
+
+    /// @brief Finally format the payload.
+    std::string to_string() const
+    {
+        std::string retval(capacity, ' ');
+        auto        n = render_to(retval.data(), retval.size());
+        if (n > retval.size()) {
+            retval.resize(n);
+            render_to(retval.data(), n);
+        }
+        retval.resize(n);
+        return retval;
+    }
+
+    /// @brief Format the payload into an output iterator (uses a stack buffer for all but very large payloads).
+    template<typename OutputIt>
+    OutputIt format_to(OutputIt out) const
+    {
+        std::array<char, 256> buffer;
+        auto                  n = render_to(buffer.data(), buffer.size());
+        if (n <= buffer.size()) return std::copy_n(buffer.data(), n, out);
+        auto str = to_string();
+        return std::copy(str.begin(), str.end(), out);
+    }
+
+private:
+    // The render functions format into a buffer of a given size and return the size the full output needs.
+    using render_type = std::size_t(std::string_view, const std::byte*, char*, std::size_t);
+
+    std::string_view m_format;           // The format string.
+    render_type*     m_render = nullptr; // Knows the argument types and their layout in the buffer.
+
+    // The buffer for the bitwise copies of the arguments.
+    alignas(std::max_align_t) std::array<std::byte, capacity> m_args{};
+
+    // The memcpy's in the constructor implicitly created objects of the right types at these offsets.
+    template<typename... Args>
+    static std::size_t render(std::string_view fmt, [[maybe_unused]] const std::byte* bytes, char* out, std::size_t n)
+    {
+        [[maybe_unused]] constexpr auto offsets = offsets_for<Args...>();
+        return [&]<std::size_t... I>(std::index_sequence<I...>) {
+            auto args = std::make_format_args(*std::launder(reinterpret_cast<const Args*>(bytes + offsets[I]))...);
+            return std::vformat_to(truncating_iterator{out, out + n}, fmt, args).count;
+        }(std::index_sequence_for<Args...>{});
+    }
+
+    std::size_t render_to(char* out, std::size_t n) const
+    {
+        return m_render ? m_render(m_format, m_args.data(), out, n) : 0;
+    }
+
+    // A type-erased `std::vformat_to` needs a fixed output iterator type -- this one counts what it can't store.
+    struct truncating_iterator {
+        using difference_type = std::ptrdiff_t;
+        char*       pos;
+        char*       end;
+        std::size_t count = 0;
+
+        truncating_iterator& operator=(char c)
+        {
+            if (pos != end) *pos++ = c;
+            ++count;
+            return *this;
+        }
+        truncating_iterator& operator*() { return *this; }
+        truncating_iterator& operator++() { return *this; }
+        truncating_iterator& operator++(int) { return *this; }
+    };
+};
+
+/// @brief A formatted message payload that is held in an inline buffer unless it is unusually long.
+/// @note  Typical payloads are therefore formatted by `std::format_to_n` without any heap allocation at all.
+class inline_payload {
+public:
+    /// @brief The number of characters that fit in the inline buffer.
+    static constexpr std::size_t capacity = 192;
+
+    /// @brief Format the payload, spilling over to a heap allocated string if it doesn't fit in the inline buffer.
+    template<typename... Args>
+    void format(std::format_string<Args...> fmt, Args&&... args)
+    {
+        auto result = std::format_to_n(m_buffer.data(), capacity, fmt, std::forward<Args>(args)...);
+        auto n = static_cast<std::size_t>(result.size);
+        if (n <= capacity) {
+            m_size = n;
+        }
+        else {
+            m_spill.clear();
+            m_spill.reserve(n);
+            std::format_to(std::back_inserter(m_spill), fmt, std::forward<Args>(args)...);
+            m_size = n;
+        }
+    }
+
+    /// @brief Copy a pre-formatted payload.
+    void assign(std::string_view str)
+    {
+        m_size = str.size();
+        if (m_size <= capacity) std::copy(str.begin(), str.end(), m_buffer.data());
+        else m_spill = str;
+    }
+
+    /// @brief Read-only access to the payload.
+    std::string_view view() const
+    {
+        return m_size <= capacity ? std::string_view{m_buffer.data(), m_size} : std::string_view{m_spill};
+    }
+
+    /// @brief Is there anything here?
+    constexpr bool empty() const { return m_size == 0; }
+
+private:
+    std::array<char, capacity> m_buffer;   // Where payloads normally live.
+    std::size_t                m_size = 0; // The size of the payload.
+    std::string                m_spill;    // Where any payload that is longer than the inline buffer lives.
+};
+
+/// @brief The interface for a destination that receives formatted messages.
+/// @note  Text arrives in blocks that always hold complete lines. Sinks may be written to from several threads.
+class log_sink {
+public:
+    virtual ~log_sink() = default;
+
+    /// @brief Write a block of text made up of one or more complete newline terminated lines.
+    virtual void write(std::string_view block) = 0;
+
+    /// @brief Push anything buffered in the sink out to its final destination.
+    virtual void flush() {}
+};
+
 /// @brief A utilities::message captures a location where the message was created and optionally a payload string.
 /// @note  These are created by the `MAKE_MESSAGE(...)` macro above that inserts the needed location information.
 class message {
@@ -43,55 +388,737 @@ public:
     /// @note  The default handler just prints the messages to a default stream
     static void use_default_handler() { c_handler = default_handler; }
 
-    /// @brief The stream used by the default message handler (you can set it to say a file stream instead).
+    /// @brief Class method that switches to a handler that queues messages for a background thread to write out.
+    /// @param policy What to do if the queue is full (by default the producing thread waits for room).
+    /// @param capacity The maximum number of pending messages (rounded up to a power of two).
+    /// @note  The background thread writes to the sink in batches and flushes that sink once per batch.
+    static void use_async_handler(overflow_policy policy = overflow_policy::block, std::size_t capacity = 8192);
+
+    /// @brief Class method that switches to a handler that formats messages into per-thread buffers.
+    /// @param buffer_size Each thread's buffer is written to the sink in one block once it holds this many bytes.
+    /// @note  Threads never contend with each other until a full buffer is handed to the sink.
+    static void use_buffered_handler(std::size_t buffer_size = 64 * 1024);
+
+    /// @brief Class method that sets the sink that all the handlers write to.
+    /// @note  By default the sink writes to the `stream` below. Set the sink before you start any logging threads.
+    static void use_sink(std::shared_ptr<log_sink> sink);
+
+    /// @brief Class method that returns the sink that all the handlers write to.
+    static log_sink& sink();
+
+    /// @brief Class method that blocks until every message so far has been written out & the sink flushed.
+    /// @note  That includes messages queued by the asynchronous handler and those in any per-thread buffers.
+    static void flush();
+
+    /// @brief Class method that returns the number of messages discarded so far by the asynchronous handler.
+    static std::size_t dropped();
+
+    /// @brief Class method that sets the runtime threshold -- messages below this level are skipped entirely.
+    static void threshold(log_level level) { c_threshold.store(level, std::memory_order_relaxed); }
+
+    /// @brief Class method that returns the current runtime threshold (by default everything gets through).
+    static log_level threshold() { return c_threshold.load(std::memory_order_relaxed); }
+
+    /// @brief Class method that checks whether messages at a given level are currently getting through.
+    static bool enabled(log_level level) { return level >= threshold(); }
+
+    /// @brief The stream used by the default sink (you can set it to say a file stream instead).
     inline static std::ostream* stream = &std::cout;
 
-    /// @brief These objects are really created using a macro that inserts the needed source code location information.
+    /// @brief A default message is empty -- this constructor is here so that messages can be stored in queues.
+    message() = default;
+
+    /// @brief Construct a message -- the location and type strings must have static storage duration.
+    /// @note  Messages are really created using a macro that inserts the needed source code location information.
     message(std::string_view func, std::string_view path, std::size_t line, std::string_view type,
             std::string_view payload = "") :
-        m_function{func}, m_filename{filename(path)}, m_line{line}, m_type{type}, m_payload{payload}
+        m_function{func}, m_filename{filename(path)}, m_line{line}, m_type{type}
     {
-        // Empty body.
+        m_payload.assign(payload);
+    }
+
+    /// @brief The factory used by the `MAKE_MESSAGE` macro for messages without a payload.
+    static message make(std::string_view func, std::string_view file, std::size_t line, std::string_view type)
+    {
+        message retval;
+        retval.m_function = func;
+        retval.m_filename = file;
+        retval.m_line = line;
+        retval.m_type = type;
+        return retval;
+    }
+
+    /// @brief The factory used by the `MAKE_MESSAGE` macro for messages with a payload.
+    /// @note  If the DEFERRED_LOGS flag is set at compile time then payloads whose arguments are all arithmetic values,
+    ///        enums, or types that opt in via `is_deferrable` are not formatted here -- formatting waits until the
+    ///        message is actually written out.
+    template<typename... Args>
+    static message make(std::string_view func, std::string_view file, std::size_t line, std::string_view type,
+                        std::format_string<Args...> fmt, Args&&... args)
+    {
+        auto retval = make(func, file, line, type);
+#ifdef DEFERRED_LOGS
+        if constexpr (deferred_payload::can_capture<Args...>) {
+            retval.m_deferred = deferred_payload{fmt.get(), args...};
+            return retval;
+        }
+#endif
+        retval.m_payload.format(fmt, std::forward<Args>(args)...);
+        return retval;
+    }
+
+    /// @brief Record how many similar messages were suppressed before this one (used by the rate limited macros).
+    message& suppressed(std::size_t count)
+    {
+        m_suppressed = count;
+        return *this;
+    }
+
+    /// @brief Writes the whole message to an output iterator e.g. "[DEBUG] 'foobar' foo.cpp line 25: x = 10, y = 11".
+    /// @note  A message with no function name has no location to report so it comes out as e.g. "[METRICS] x = 10".
+    template<typename OutputIt>
+    OutputIt format_to(OutputIt out) const
+    {
+        auto located = !m_function.empty();
+        out = std::format_to(out, "[{}]", m_type);
+        if (located) out = std::format_to(out, " function '{}' ({}, line {})", m_function, m_filename, m_line);
+        if (!m_deferred.empty() || !m_payload.empty()) {
+            if (located) *out++ = ':';
+            *out++ = ' ';
+        }
+        if (!m_deferred.empty()) {
+            out = m_deferred.format_to(out);
+        }
+        else if (!m_payload.empty()) {
+            auto payload = m_payload.view();
+            out = std::copy(payload.begin(), payload.end(), out);
+        }
+        if (m_suppressed > 0) out = std::format_to(out, " (similar messages suppressed: {})", m_suppressed);
+        return out;
     }
 
     /// @brief Returns the whole message as a string e.g. "[DEBUG] 'foobar' foo.cpp line 25: x = 10, y = 11".
     std::string to_string() const
     {
-        auto retval = std::format("[{}] function '{}' ({}, line {})", m_type, m_function, m_filename, m_line);
-        if (!m_payload.empty()) {
-            retval += ": ";
-            retval += m_payload;
-        }
+        std::string retval;
+        format_to(std::back_inserter(retval));
+        return retval;
+    }
+
+    /// @brief Returns the whole message as a string allocated from a memory resource.
+    /// @note  The fields of a message are views of static strings & short payloads live inline, so this copy is the
+    ///        only allocation you ever see from a message.
+    std::pmr::string to_string(std::pmr::memory_resource* mr) const
+    {
+        std::pmr::string retval{mr};
+        format_to(std::back_inserter(retval));
         return retval;
     }
 
     /// @brief Dispatch this message to the message handler.
     void dispatch() const { c_handler(*this); }
 
-    /// @brief The default message handler just prints the message to the default stream.
-    static void default_handler(const message& message) { *stream << message.to_string() << std::endl; }
+    /// @brief The default message handler just writes the message as one line to the sink (without a flush).
+    static void default_handler(const message& message)
+    {
+        thread_local std::string buffer;
+        buffer.clear();
+        message.format_to(std::back_inserter(buffer));
+        buffer += '\n';
+        sink().write(buffer);
+    }
+
+    /// @brief The asynchronous message handler just queues the message for the background writer thread.
+    static void async_handler(const message& message);
+
+    /// @brief The buffered message handler appends the message to the calling thread's buffer.
+    static void buffered_handler(const message& message);
 
     /// @brief Reduce a full path to just the filename.
-    static std::string filename(std::string_view path)
+    static constexpr std::string_view filename(std::string_view path)
     {
         char sep = '/';
 #ifdef _WIN32
         sep = '\\';
 #endif
         auto i = path.rfind(sep, path.length());
-        if (i != std::string::npos) return std::string{path.substr(i + 1, path.length() - i)};
-        return "";
+        return i != std::string_view::npos ? path.substr(i + 1, path.length() - i) : path;
     }
 
+    /// @brief Reduce a full path to just the filename at compile time (used by the `MAKE_MESSAGE` macro).
+    static consteval std::string_view basename(std::string_view path) { return filename(path); }
+
 private:
-    std::string m_function; // Function/method where the message originated from.
-    std::string m_filename; // Filename where the message originated from (just the filename not the path).
-    std::size_t m_line;     // Line in the file where the message originated.
-    std::string m_type;     // The type of this message e.g. "DEBUG".
-    std::string m_payload;  // Any user supplied string that goes with this message.
+    std::string_view m_function; // Function/method where the message originated from.
+    std::string_view m_filename; // Filename where the message originated from (just the filename not the path).
+    std::size_t      m_line = 0; // Line in the file where the message originated.
+    std::string_view m_type;     // The type of this message e.g. "DEBUG".
+    inline_payload   m_payload;  // Any user supplied string that goes with this message.
+    deferred_payload m_deferred; // Alternatively, a payload that has yet to be formatted.
+    std::size_t      m_suppressed = 0; // The number of messages from the same call site suppressed before this one.
 
     // User can set the a handler for all messages -- the default just prints the message to the default stream.
     inline static handler_type* c_handler = default_handler;
+
+    // Messages below this level are discarded before they are even created.
+    inline static std::atomic<log_level> c_threshold = log_level::trace;
+
+    // The sink that all the handlers write to -- if this is null we use a sink that writes to `stream`.
+    inline static std::shared_ptr<log_sink> c_sink_owner;
+    inline static std::atomic<log_sink*>    c_sink = nullptr;
+
+    // The size at which each thread's buffer gets written to the sink by the buffered handler.
+    inline static std::atomic<std::size_t> c_buffer_size = 64 * 1024;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Some message sinks.
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief A sink that writes to an output stream (the default one follows whatever `message::stream` points to).
+class ostream_sink : public log_sink {
+public:
+    /// @brief Write to `message::stream` (which you can change at any time).
+    constexpr ostream_sink() = default;
+
+    /// @brief Write to a specific stream that must outlive the sink.
+    explicit ostream_sink(std::ostream& os) : m_stream{&os} {}
+
+    void write(std::string_view block) override
+    {
+        std::lock_guard lock{m_mutex};
+        stream().write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+
+    void flush() override
+    {
+        std::lock_guard lock{m_mutex};
+        stream().flush();
+    }
+
+private:
+    std::ostream* m_stream = nullptr;
+    std::mutex    m_mutex;
+
+    std::ostream& stream() const { return m_stream ? *m_stream : *message::stream; }
+};
+
+/// @brief A sink that writes to a file through a large stdio buffer so most writes never reach the kernel.
+class file_sink : public log_sink {
+public:
+    /// @brief Opens the file for appending (or truncates it) & fails with a @c std::runtime_error if that fails.
+    explicit file_sink(const std::filesystem::path& path, std::size_t buffer_size = 1024 * 1024, bool append = true) :
+        m_path{path}, m_buffer(buffer_size)
+    {
+        open(append);
+    }
+
+    ~file_sink() override { close(); }
+
+    file_sink(const file_sink&) = delete;
+    file_sink& operator=(const file_sink&) = delete;
+
+    void write(std::string_view block) override
+    {
+        std::lock_guard lock{m_mutex};
+        write_locked(block);
+    }
+
+    void flush() override
+    {
+        std::lock_guard lock{m_mutex};
+        std::fflush(m_file);
+    }
+
+    /// @brief The path to the file we are writing to.
+    const std::filesystem::path& path() const { return m_path; }
+
+protected:
+    std::filesystem::path m_path;
+    std::vector<char>     m_buffer;
+    std::FILE*            m_file = nullptr;
+    std::uintmax_t        m_size = 0; // Bytes in the file so far.
+    std::mutex            m_mutex;
+
+    void write_locked(std::string_view block)
+    {
+        m_size += std::fwrite(block.data(), 1, block.size(), m_file);
+    }
+
+    void open(bool append)
+    {
+        m_file = std::fopen(m_path.string().c_str(), append ? "ab" : "wb");
+        if (!m_file) throw std::runtime_error{std::format("Failed to open log file '{}'", m_path.string())};
+        if (!m_buffer.empty()) std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+        std::error_code ec;
+        m_size = append ? std::filesystem::file_size(m_path, ec) : 0;
+        if (ec) m_size = 0;
+    }
+
+    void close()
+    {
+        if (m_file) std::fclose(m_file);
+        m_file = nullptr;
+    }
+};
+
+/// @brief A file sink that starts a new file whenever the current one would exceed a maximum size.
+/// @note  The file "name.log" is rotated to "name.log.1" which is rotated to "name.log.2" and so on.
+///        At most `max_files` of the older files are kept around.
+class rotating_file_sink : public file_sink {
+public:
+    rotating_file_sink(const std::filesystem::path& path, std::size_t max_size, std::size_t max_files = 5,
+                       std::size_t buffer_size = 1024 * 1024) :
+        file_sink{path, buffer_size}, m_max_size{max_size}, m_max_files{max_files}
+    {
+        // Empty body.
+    }
+
+    void write(std::string_view block) override
+    {
+        std::lock_guard lock{m_mutex};
+        if (m_size > 0 && m_size + block.size() > m_max_size) rotate();
+        write_locked(block);
+    }
+
+private:
+    std::size_t m_max_size;
+    std::size_t m_max_files;
+
+    // Shuffle all the older files up one & start afresh.
+    void rotate()
+    {
+        close();
+        auto older = [this](std::size_t i) { return std::filesystem::path{std::format("{}.{}", m_path.string(), i)}; };
+        std::error_code ec;
+        if (m_max_files > 0) {
+            std::filesystem::remove(older(m_max_files), ec);
+            for (auto i = m_max_files - 1; i > 0; --i) std::filesystem::rename(older(i), older(i + 1), ec);
+            std::filesystem::rename(m_path, older(1), ec);
+        }
+        open(false);
+    }
 };
 
+/// @brief A sink that keeps the most recent output in a fixed-size ring buffer -- useful for crash dumps.
+class memory_sink : public log_sink {
+public:
+    explicit memory_sink(std::size_t capacity = 1024 * 1024) : m_ring(std::max<std::size_t>(capacity, 1)) {}
+
+    void write(std::string_view block) override
+    {
+        std::lock_guard lock{m_mutex};
+        if (block.size() > m_ring.size()) block.remove_prefix(block.size() - m_ring.size());
+        for (auto c : block) {
+            m_ring[m_pos] = c;
+            if (++m_pos == m_ring.size()) {
+                m_pos = 0;
+                m_wrapped = true;
+            }
+        }
+    }
+
+    /// @brief Returns the retained text starting at the first complete line.
+    std::string contents() const
+    {
+        std::lock_guard lock{m_mutex};
+        if (!m_wrapped) return std::string{m_ring.data(), m_pos};
+        std::string retval{m_ring.data() + m_pos, m_ring.size() - m_pos};
+        retval.append(m_ring.data(), m_pos);
+        auto nl = retval.find('\n');
+        if (nl != std::string::npos && nl + 1 < retval.size()) retval.erase(0, nl + 1);
+        return retval;
+    }
+
+    /// @brief Discard everything retained so far.
+    void clear()
+    {
+        std::lock_guard lock{m_mutex};
+        m_pos = 0;
+        m_wrapped = false;
+    }
+
+private:
+    std::vector<char>  m_ring;
+    std::size_t        m_pos = 0;
+    bool               m_wrapped = false;
+    mutable std::mutex m_mutex;
+};
+
+inline void
+message::use_sink(std::shared_ptr<log_sink> sink)
+{
+    flush();
+    c_sink.store(sink.get(), std::memory_order_release);
+    c_sink_owner = std::move(sink);
+}
+
+/// @brief The default sink is constant initialised so it outlives every function-local static.
+/// @note  In particular, it is still there when the asynchronous writer drains its queue at program exit.
+inline constinit ostream_sink default_sink;
+
+inline log_sink&
+message::sink()
+{
+    auto retval = c_sink.load(std::memory_order_acquire);
+    return retval ? *retval : default_sink;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// The machinery behind the buffered message handler.
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief Each thread that logs through the buffered handler gets one of these buffers.
+/// @note  The mutex is only ever contended if `message::flush()` is called while the owning thread is logging.
+class thread_buffer {
+public:
+    thread_buffer()
+    {
+        std::lock_guard lock{registry_mutex()};
+        registry().push_back(this);
+    }
+
+    /// @brief Anything left over when the thread exits is written out.
+    ~thread_buffer()
+    {
+        {
+            std::lock_guard lock{registry_mutex()};
+            std::erase(registry(), this);
+        }
+        flush();
+    }
+
+    thread_buffer(const thread_buffer&) = delete;
+    thread_buffer& operator=(const thread_buffer&) = delete;
+
+    /// @brief The buffer for the calling thread.
+    static thread_buffer& local()
+    {
+        thread_local thread_buffer s_buffer;
+        return s_buffer;
+    }
+
+    /// @brief Append a message & write the buffer to the sink if it is full.
+    void append(const message& msg, std::size_t buffer_size)
+    {
+        std::lock_guard lock{m_mutex};
+        msg.format_to(std::back_inserter(m_text));
+        m_text += '\n';
+        if (m_text.size() >= buffer_size) write();
+    }
+
+    /// @brief Write whatever is in the buffer to the sink.
+    void flush()
+    {
+        std::lock_guard lock{m_mutex};
+        write();
+    }
+
+    /// @brief Write out the buffers for all threads.
+    static void flush_all()
+    {
+        std::lock_guard lock{registry_mutex()};
+        for (auto buffer : registry()) buffer->flush();
+    }
+
+private:
+    std::mutex  m_mutex;
+    std::string m_text;
+
+    void write()
+    {
+        if (m_text.empty()) return;
+        message::sink().write(m_text);
+        m_text.clear();
+    }
+
+    static std::vector<thread_buffer*>& registry()
+    {
+        static std::vector<thread_buffer*> s_registry;
+        return s_registry;
+    }
+
+    static std::mutex& registry_mutex()
+    {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+};
+
+inline void
+message::use_buffered_handler(std::size_t buffer_size)
+{
+    c_buffer_size.store(buffer_size, std::memory_order_relaxed);
+    c_handler = buffered_handler;
+}
+
+inline void
+message::buffered_handler(const message& message)
+{
+    thread_buffer::local().append(message, c_buffer_size.load(std::memory_order_relaxed));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// The machinery behind the asynchronous message handler.
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief A bounded multi-producer, multi-consumer lock-free queue (Dmitry Vyukov's classic ring buffer design).
+/// @note  The capacity is rounded up to a power of two. Each slot carries a sequence number that tells producers and
+///        consumers whether it is free to write or ready to read, so the only contention is on the two cursors.
+template<typename T>
+class bounded_queue {
+public:
+    explicit bounded_queue(std::size_t capacity) :
+        m_slots{std::make_unique<slot[]>(std::bit_ceil(std::max<std::size_t>(capacity, 2)))},
+        m_mask{std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1}
+    {
+        for (std::size_t i = 0; i <= m_mask; ++i) m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /// @brief The number of slots in the queue.
+    constexpr std::size_t capacity() const { return m_mask + 1; }
+
+    /// @brief Tries to move a value into the queue -- returns false if the queue is full.
+    bool try_push(T&& value)
+    {
+        auto pos = m_push.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& s = m_slots[pos & m_mask];
+            auto  seq = s.sequence.load(std::memory_order_acquire);
+            auto  dif = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (dif == 0) {
+                if (m_push.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.value = std::move(value);
+                    s.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0) {
+                return false;
+            }
+            else {
+                pos = m_push.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief Tries to move the oldest value out of the queue -- returns false if the queue is empty.
+    bool try_pop(T& value)
+    {
+        auto pos = m_pop.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& s = m_slots[pos & m_mask];
+            auto  seq = s.sequence.load(std::memory_order_acquire);
+            auto  dif = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (dif == 0) {
+                if (m_pop.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(s.value);
+                    s.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0) {
+                return false;
+            }
+            else {
+                pos = m_pop.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct slot {
+        std::atomic<std::size_t> sequence;
+        T                        value;
+    };
+
+    std::unique_ptr<slot[]> m_slots;
+    std::size_t             m_mask;
+
+    // The two cursors live on separate cache lines so producers and consumers don't falsely share.
+    alignas(64) std::atomic<std::size_t> m_push = 0;
+    alignas(64) std::atomic<std::size_t> m_pop = 0;
+};
+
+/// @brief The background writer that sits behind `message::async_handler`.
+/// @note  Producers push messages into a lock-free queue and a single thread drains it to `message::sink()`.
+class async_writer {
+public:
+    async_writer(overflow_policy policy, std::size_t capacity) :
+        m_queue{capacity}, m_policy{policy}, m_thread{[this] { run(); }}
+    {
+        // Empty body.
+    }
+
+    /// @brief On destruction we write out everything that is still pending (this is what runs at program exit).
+    ~async_writer()
+    {
+        m_stop.store(true, std::memory_order_release);
+        wake();
+        m_thread.join();
+    }
+
+    async_writer(const async_writer&) = delete;
+    async_writer& operator=(const async_writer&) = delete;
+
+    /// @brief Class method that returns the writer (if any) that messages currently go to.
+    /// @note  Producers read this without taking any locks. It is null before the first `message::use_async_handler`
+    ///        & again once the writers have been shut down at program exit.
+    static async_writer* current() { return c_current.load(std::memory_order_acquire); }
+
+    /// @brief Class method that creates a new writer & makes it the current one.
+    /// @note  Other threads may still be pushing to the previous writer so that one is flushed but kept running until
+    ///        program exit -- it is never destroyed out from under a producer.
+    static void install(overflow_policy policy, std::size_t capacity)
+    {
+        auto&            all = writers();
+        std::scoped_lock lock{all.mutex};
+        all.owned.push_back(std::make_unique<async_writer>(policy, capacity));
+        if (auto previous = c_current.exchange(all.owned.back().get(), std::memory_order_acq_rel)) previous->flush();
+    }
+
+    /// @brief Class method that returns the number of messages discarded by all the writers so far.
+    static std::size_t total_dropped()
+    {
+        auto&            all = writers();
+        std::scoped_lock lock{all.mutex};
+        std::size_t      retval = 0;
+        for (const auto& writer : all.owned) retval += writer->dropped();
+        return retval;
+    }
+
+    /// @brief Queue a message, applying the overflow policy if the queue happens to be full.
+    void push(message msg)
+    {
+        while (!m_queue.try_push(std::move(msg))) {
+            if (m_policy == overflow_policy::drop_newest) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (m_policy == overflow_policy::drop_oldest) {
+                message oldest;
+                if (m_queue.try_pop(oldest)) {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    m_done.fetch_add(1, std::memory_order_release);
+                }
+                continue;
+            }
+            std::this_thread::yield();
+        }
+        m_pushed.fetch_add(1, std::memory_order_release);
+        wake();
+    }
+
+    /// @brief Blocks until everything queued before the call has been written out.
+    void flush()
+    {
+        auto target = m_pushed.load(std::memory_order_acquire);
+        wake();
+        for (auto done = m_done.load(std::memory_order_acquire); done < target;
+             done = m_done.load(std::memory_order_acquire)) {
+            m_done.wait(done, std::memory_order_acquire);
+        }
+    }
+
+    /// @brief The number of messages discarded because the queue was full.
+    std::size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    bounded_queue<message>   m_queue;
+    overflow_policy          m_policy;
+    std::atomic<std::size_t> m_pushed = 0;  // Number of messages successfully queued.
+    std::atomic<std::size_t> m_done = 0;    // Number of those that have been either written or dropped.
+    std::atomic<std::size_t> m_dropped = 0; // Number of messages dropped because the queue was full.
+    std::atomic<std::size_t> m_events = 0;  // Bumped whenever the writer thread has something to do.
+    std::atomic<bool>        m_stop = false;
+    std::thread              m_thread;      // Declared last so that it starts after everything else is ready.
+
+    // The current writer is constant initialised so producers can still safely check it during static destruction.
+    inline static constinit std::atomic<async_writer*> c_current = nullptr;
+
+    // All the writers ever installed. At program exit the current one is unpublished & then they are all drained.
+    struct writer_list {
+        std::mutex                                 mutex;
+        std::vector<std::unique_ptr<async_writer>> owned;
+
+        ~writer_list()
+        {
+            c_current.store(nullptr, std::memory_order_release);
+            while (!owned.empty()) owned.pop_back();
+        }
+    };
+
+    static writer_list& writers()
+    {
+        static writer_list retval;
+        return retval;
+    }
+
+    void wake()
+    {
+        m_events.fetch_add(1, std::memory_order_release);
+        m_events.notify_one();
+    }
+
+    // The writer thread drains the queue in batches with one stream flush per batch.
+    void run()
+    {
+        message     msg;
+        std::string batch;
+        for (;;) {
+            auto events = m_events.load(std::memory_order_acquire);
+            auto stop = m_stop.load(std::memory_order_acquire);
+
+            std::size_t n = 0;
+            while (m_queue.try_pop(msg)) {
+                msg.format_to(std::back_inserter(batch));
+                batch += '\n';
+                ++n;
+                if (batch.size() >= 64 * 1024) {
+                    message::sink().write(batch);
+                    batch.clear();
+                }
+            }
+            if (n > 0) {
+                if (!batch.empty()) message::sink().write(batch);
+                message::sink().flush();
+                batch.clear();
+                m_done.fetch_add(n, std::memory_order_release);
+                m_done.notify_all();
+            }
+
+            if (stop) return;
+            m_events.wait(events, std::memory_order_acquire);
+        }
+    }
+};
+
+inline void
+message::use_async_handler(overflow_policy policy, std::size_t capacity)
+{
+    async_writer::install(policy, capacity);
+
+    // Only write the handler if it changes so calling this again while other threads are logging is safe.
+    if (c_handler != async_handler) c_handler = async_handler;
+}
+
+inline void
+message::async_handler(const message& message)
+{
+    // Messages that arrive after the writer has gone (e.g. during static destruction) are written out directly.
+    if (auto writer = async_writer::current()) writer->push(message);
+    else default_handler(message);
+}
+
+inline void
+message::flush()
+{
+    thread_buffer::flush_all();
+    if (auto writer = async_writer::current()) writer->flush();
+    sink().flush();
+}
+
+inline std::size_t
+message::dropped()
+{
+    return async_writer::total_dropped();
+}
+
 } // namespace utilities
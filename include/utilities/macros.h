@@ -64,3 +64,51 @@
 #else
     #define COMPILER_NAME "Unidentified Compiler"
 #endif
+
+/// @brief Portable hints for the optimizer -- they expand to the compiler specific builtins & attributes (or nothing).
+/// @note  `LIKELY(x)` & `UNLIKELY(x)` wrap a condition you expect to be true/false almost all the time.
+///        `ASSUME(x)` tells the optimizer that `x` is always true -- it is undefined behaviour if it isn't!
+///        `FORCE_INLINE` & `NOINLINE` go in front of a function declaration as does `COLD` which marks a function as
+///        rarely called so it gets laid out away from the hot code. `PREFETCH(addr)` asks for the cache line holding
+///        `addr` to be loaded ahead of time. `RESTRICT` is the C style promise that a pointer is not aliased.
+#if defined(__GNUC__) || defined(__clang__)
+    #define LIKELY(x)      __builtin_expect(!!(x), 1)
+    #define UNLIKELY(x)    __builtin_expect(!!(x), 0)
+    #define FORCE_INLINE   inline __attribute__((always_inline))
+    #define NOINLINE       __attribute__((noinline))
+    #define COLD           __attribute__((cold))
+    #define PREFETCH(addr) __builtin_prefetch(addr)
+    #define RESTRICT       __restrict__
+#elif defined(_MSC_VER)
+    #define LIKELY(x)      (!!(x))
+    #define UNLIKELY(x)    (!!(x))
+    #define FORCE_INLINE   __forceinline
+    #define NOINLINE       __declspec(noinline)
+    #define COLD
+    #define PREFETCH(addr) void(addr)
+    #define RESTRICT       __restrict
+#else
+    #define LIKELY(x)      (!!(x))
+    #define UNLIKELY(x)    (!!(x))
+    #define FORCE_INLINE   inline
+    #define NOINLINE
+    #define COLD
+    #define PREFETCH(addr) void(addr)
+    #define RESTRICT
+#endif
+
+// ASSUME is a statement rather than an expression -- we prefer the C++23 attribute & fall back on the builtins.
+#if __has_cpp_attribute(assume)
+    #define ASSUME(x) [[assume(x)]]
+#elif defined(__clang__)
+    #define ASSUME(x) __builtin_assume(x)
+#elif defined(__GNUC__)
+    #define ASSUME(x)                          \
+        do {                                   \
+            if (!(x)) __builtin_unreachable(); \
+        } while (0)
+#elif defined(_MSC_VER)
+    #define ASSUME(x) __assume(x)
+#else
+    #define ASSUME(x) void(0)
+#endif
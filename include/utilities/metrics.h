@@ -0,0 +1,556 @@
+/// @brief Always-on in-process metrics (counters, gauges, & timers) with periodic reporting through the log.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "log.h"
+#include "macros.h"
+#include "stopwatch.h"
+#include "thread_slots.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/// @brief Count events, move a gauge, or time the rest of the enclosing scope, all against the metric called `name`.
+/// @note  Each call site caches its metric in a static so after the first visit the cost is a relaxed add to a slot
+///        owned by the calling thread. Like `NO_PROFILE` for the profiling zones, setting the `NO_METRICS` flag at
+///        compile time removes them all.
+#ifndef NO_METRICS
+    #define METRIC_ADD(name, n)                                                                                        \
+        do {                                                                                                           \
+            static const utilities::counter CONCAT(utilities_metric_, __LINE__){name};                                 \
+            CONCAT(utilities_metric_, __LINE__).add(n);                                                                \
+        } while (false)
+    #define METRIC_GAUGE_ADD(name, n)                                                                                  \
+        do {                                                                                                           \
+            static const utilities::gauge CONCAT(utilities_metric_, __LINE__){name};                                   \
+            CONCAT(utilities_metric_, __LINE__).add(n);                                                                \
+        } while (false)
+    #define METRIC_TIME_SCOPE(name)                                                                                    \
+        static const utilities::timer CONCAT(utilities_metric_, __LINE__){name};                                       \
+        const utilities::timer_guard CONCAT(utilities_metric_guard_, __LINE__)                                         \
+        {                                                                                                              \
+            CONCAT(utilities_metric_, __LINE__)                                                                        \
+        }
+#else
+    #define METRIC_ADD(name, n)       void(0)
+    #define METRIC_GAUGE_ADD(name, n) void(0)
+    #define METRIC_TIME_SCOPE(name)   void(0)
+#endif
+
+/// @brief Count one event against the counter called `name`.
+#define METRIC_COUNT(name) METRIC_ADD(name, 1)
+
+namespace utilities {
+
+/// @brief The kinds of metric we keep track of.
+enum class metric_kind {
+    counter, // Counts events -- each snapshot reports the count since the previous one.
+    gauge,   // A level that moves up & down e.g. the number of requests in flight -- never reset.
+    timer    // Durations fed into a `latency_histogram` -- each snapshot reports those since the previous one.
+};
+
+/// @brief Returns a metric kind as a string e.g. "counter".
+constexpr std::string_view
+metric_kind_name(metric_kind kind)
+{
+    switch (kind) {
+        case metric_kind::counter: return "counter";
+        case metric_kind::gauge: return "gauge";
+        case metric_kind::timer: return "timer";
+    }
+    return "unknown";
+}
+
+/// @brief The names & kinds of all the metrics -- each name gets a small integer id that indexes the slots below.
+/// @note  Looking a name up takes a lock but that only happens when a metric handle is created. Metrics past the
+///        capacity all share one overflow slot that is never reported.
+class metric_names {
+public:
+    /// @brief The most metrics we keep track of.
+    static constexpr std::size_t capacity = 256;
+
+    /// @brief Class method that returns the id for a metric, adding the metric if it is new.
+    /// @throw std::invalid_argument if the name is already in use by a different kind of metric.
+    static std::size_t id(std::string_view name, metric_kind kind)
+    {
+        start();
+        std::scoped_lock lock{mutex()};
+        auto&            all = entries();
+        for (std::size_t i = 0; i < all.size(); ++i) {
+            if (all[i].name != name) continue;
+            if (all[i].kind != kind)
+                throw std::invalid_argument(std::format("Metric '{}' is a {} not a {}", name,
+                                                        metric_kind_name(all[i].kind), metric_kind_name(kind)));
+            return i;
+        }
+        if (all.size() == capacity) return capacity;
+        all.push_back({std::string{name}, kind});
+        return all.size() - 1;
+    }
+
+    /// @brief One entry in the list of metrics.
+    struct entry {
+        std::string name;
+        metric_kind kind;
+    };
+
+    /// @brief Class method that returns the time the first metric was created -- where the first interval starts.
+    static std::chrono::steady_clock::time_point start()
+    {
+        static const auto retval = std::chrono::steady_clock::now();
+        return retval;
+    }
+
+    /// @brief Class method that constructs the shared state now so anything created later is destroyed before it.
+    static void initialize()
+    {
+        start();
+        std::scoped_lock lock{mutex()};
+        entries();
+    }
+
+    /// @brief Class method that returns a copy of the list of all the metrics so far in id order.
+    static std::vector<entry> all()
+    {
+        std::scoped_lock lock{mutex()};
+        return entries();
+    }
+
+private:
+    static std::vector<entry>& entries()
+    {
+        static std::vector<entry> retval;
+        return retval;
+    }
+
+    static std::mutex& mutex()
+    {
+        static std::mutex retval;
+        return retval;
+    }
+};
+
+/// @brief The value of every metric as seen by one thread -- `thread_slots` gives each thread its own set.
+/// @note  A counter or gauge lives in one atomic per thread. Counting is then a relaxed load & store on a slot no other
+///        thread writes to, while a snapshot can still sum the slots mid-flight. Timer histograms are far too big
+///        for that so each thread's set hangs off a private lock that the owner takes for every duration it records.
+///        The reporting thread is the only other taker so in practice that lock is never contended.
+class metric_slots {
+public:
+    /// @brief Returns the slots for the calling thread.
+    static metric_slots& local() { return registry::local(); }
+
+    /// @brief Adds to a counter or gauge (only ever called by the owning thread).
+    /// @note  Gauges are signed but we keep everything as unsigned -- wrap-around makes the sums come out right.
+    void add(std::size_t id, std::uint64_t n)
+    {
+        auto& slot = m_values[id];
+        slot.store(slot.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /// @brief Records a duration in seconds for a timer (only ever called by the owning thread).
+    void record(std::size_t id, double seconds)
+    {
+        std::scoped_lock lock{m_mutex};
+        auto&            histogram = m_histograms[id];
+        if (!histogram) histogram = std::make_unique<latency_histogram>();
+        histogram->record(seconds);
+    }
+
+    /// @brief Class method that returns the totals for all the counters & gauges across all the threads.
+    /// @note  The histograms for the timers are merged into `histograms` & then reset.
+    static std::array<std::uint64_t, metric_names::capacity>
+    collect(std::array<std::unique_ptr<latency_histogram>, metric_names::capacity>& histograms)
+    {
+        return registry::visit([&histograms](retired_values& old, const auto& live) {
+            std::array<std::uint64_t, metric_names::capacity> retval = old.values;
+            move_histograms(old.histograms, histograms);
+            for (auto* slots : live) {
+                for (std::size_t i = 0; i < metric_names::capacity; ++i)
+                    retval[i] += slots->m_values[i].load(std::memory_order_relaxed);
+                std::scoped_lock slots_lock{slots->m_mutex};
+                move_histograms(slots->m_histograms, histograms);
+            }
+            return retval;
+        });
+    }
+
+    /// @brief Class method that constructs the shared state now so anything created later is destroyed before it.
+    static void initialize() { registry::initialize(); }
+
+    metric_slots(const metric_slots&) = delete;
+    metric_slots& operator=(const metric_slots&) = delete;
+
+private:
+    using histograms_type = std::array<std::unique_ptr<latency_histogram>, metric_names::capacity + 1>;
+
+    // What the threads that have exited leave behind.
+    struct retired_values {
+        std::array<std::uint64_t, metric_names::capacity> values{};
+        histograms_type                                   histograms;
+    };
+
+    using registry = thread_slots<metric_slots, retired_values>;
+    friend registry;
+
+    std::array<std::atomic<std::uint64_t>, metric_names::capacity + 1> m_values{}; // The last is the overflow slot.
+    histograms_type                                                    m_histograms;
+    std::mutex                                                         m_mutex; // Guards the histograms.
+
+    metric_slots() = default;
+
+    // Called with the registry locked as the owning thread exits.
+    void retire_into(retired_values& old)
+    {
+        for (std::size_t i = 0; i < metric_names::capacity; ++i)
+            old.values[i] += m_values[i].load(std::memory_order_relaxed);
+        std::scoped_lock lock{m_mutex};
+        move_histograms(m_histograms, old.histograms);
+    }
+
+    // Merges any histograms in `from` into `to` (ignoring the overflow slot) & resets the ones in `from`.
+    template<typename From, typename To>
+    static void move_histograms(From& from, To& to)
+    {
+        for (std::size_t i = 0; i < metric_names::capacity; ++i) {
+            if (!from[i] || from[i]->count() == 0) continue;
+            if (!to[i]) to[i] = std::make_unique<latency_histogram>();
+            to[i]->merge(*from[i]);
+            from[i]->reset();
+        }
+    }
+};
+
+/// @brief A handle for a counter -- copies are cheap & all handles with the same name count into the same metric.
+class counter {
+public:
+    explicit counter(std::string_view name) : m_id{metric_names::id(name, metric_kind::counter)} {}
+
+    /// @brief Counts `n` events.
+    void add(std::uint64_t n = 1) const { metric_slots::local().add(m_id, n); }
+
+    /// @brief Counts one event.
+    void increment() const { add(1); }
+
+private:
+    std::size_t m_id;
+};
+
+/// @brief A handle for a gauge -- a level that goes up & down, e.g. the number of requests in flight.
+/// @note  As the level is spread over the threads that move it there is no `set` -- just changes to the level.
+class gauge {
+public:
+    explicit gauge(std::string_view name) : m_id{metric_names::id(name, metric_kind::gauge)} {}
+
+    /// @brief Moves the level by `n` which can be negative.
+    void add(std::int64_t n) const { metric_slots::local().add(m_id, static_cast<std::uint64_t>(n)); }
+
+    /// @brief Moves the level down by `n`.
+    void sub(std::int64_t n) const { add(-n); }
+
+    /// @brief Moves the level up by one.
+    void increment() const { add(1); }
+
+    /// @brief Moves the level down by one.
+    void decrement() const { add(-1); }
+
+private:
+    std::size_t m_id;
+};
+
+class timer_guard;
+
+/// @brief A handle for a timer -- durations are recorded in a `latency_histogram` so snapshots report percentiles.
+class timer {
+public:
+    explicit timer(std::string_view name) : m_id{metric_names::id(name, metric_kind::timer)} {}
+
+    /// @brief Records a duration in seconds e.g. the `lap()` from a stopwatch.
+    void record(double seconds) const { metric_slots::local().record(m_id, seconds); }
+
+    /// @brief Returns a guard that records its own lifetime when it goes out of scope.
+    [[nodiscard]] timer_guard time() const;
+
+private:
+    std::size_t m_id;
+};
+
+/// @brief Records the time from its construction to its destruction as one duration for a timer.
+/// @note  `METRIC_TIME_SCOPE` & `timer::time()` hand these out. Both clock reads end up inside every duration recorded
+///        so the guard uses the cycle counter clock -- about the cheapest clock there is.
+class timer_guard {
+public:
+    explicit timer_guard(const timer& t) : m_timer{t} {}
+    ~timer_guard() { m_timer.record(m_stopwatch.elapsed()); }
+
+    timer_guard(const timer_guard&) = delete;
+    timer_guard& operator=(const timer_guard&) = delete;
+
+private:
+    timer           m_timer;     // The timer we record into.
+    cycle_stopwatch m_stopwatch; // Started on construction.
+};
+
+inline timer_guard
+timer::time() const
+{
+    return timer_guard{*this};
+}
+
+/// @brief The values of all the metrics over an interval -- usually the interval since the previous snapshot.
+struct metrics_snapshot {
+    /// @brief A counter and the number of events counted in the interval.
+    struct counter_reading {
+        std::string   name;
+        std::uint64_t count;
+    };
+
+    /// @brief A gauge and its level at the end of the interval.
+    struct gauge_reading {
+        std::string  name;
+        std::int64_t level;
+    };
+
+    /// @brief A timer and the durations it recorded in the interval.
+    struct timer_reading {
+        std::string       name;
+        latency_histogram histogram;
+    };
+
+    double                       interval = 0; // The length of the interval in seconds.
+    std::vector<counter_reading> counters;
+    std::vector<gauge_reading>   gauges;
+    std::vector<timer_reading>   timers;
+
+    /// @brief Returns the rate per second for a count over the interval.
+    constexpr double rate(std::uint64_t count) const
+    {
+        return interval > 0 ? static_cast<double>(count) / interval : 0;
+    }
+
+    /// @brief Returns the lines of the snapshot, one per metric, e.g. "counter requests: 1200 (120.0/s)".
+    std::vector<std::string> lines() const
+    {
+        std::vector<std::string> retval;
+        for (const auto& c : counters)
+            retval.push_back(std::format("counter {}: {} ({:.1f}/s)", c.name, c.count, rate(c.count)));
+        for (const auto& g : gauges) retval.push_back(std::format("gauge {}: {}", g.name, g.level));
+        for (const auto& t : timers) retval.push_back(std::format("timer {}: {}", t.name, t.histogram.to_string()));
+        return retval;
+    }
+
+    /// @brief Returns the whole snapshot with a header line & then one line per metric.
+    std::string to_string() const
+    {
+        auto retval = std::format("metrics over {}\n", duration_string(interval));
+        for (const auto& line : lines()) {
+            retval += line;
+            retval += '\n';
+        }
+        return retval;
+    }
+};
+
+/// @brief Usual output operator.
+inline std::ostream&
+operator<<(std::ostream& os, const metrics_snapshot& rhs)
+{
+    return os << rhs.to_string();
+}
+
+/// @brief The interface for a destination that receives metrics snapshots.
+class metrics_exporter {
+public:
+    virtual ~metrics_exporter() = default;
+
+    /// @brief Export a snapshot. These come from whichever thread took the snapshot.
+    virtual void write(const metrics_snapshot& snapshot) = 0;
+};
+
+/// @brief The default exporter sends each metric in a snapshot through the current `message::handler()`.
+/// @note  So the metrics end up wherever the log goes e.g. "[METRICS] counter requests: 1200 (120.0/s)". The messages
+///        have no source location as the only one we could give them is this `write` method.
+class log_exporter : public metrics_exporter {
+public:
+    void write(const metrics_snapshot& snapshot) override
+    {
+        if (!message::enabled(log_level::info)) return;
+        for (const auto& line : snapshot.lines()) message{"", "", 0, "METRICS", line}.dispatch();
+    }
+};
+
+/// @brief The registry that takes snapshots of all the metrics & hands them to an exporter.
+class metrics_registry {
+public:
+    /// @brief Class method that takes a snapshot of all the metrics & starts a new interval.
+    /// @note  Counters & timers report what happened since the previous snapshot, gauges report their current level.
+    ///        Nothing is lost if other threads are counting at the same time, their events just land in either this
+    ///        interval or the next one.
+    static metrics_snapshot snapshot()
+    {
+        auto&            s = state();
+        std::scoped_lock lock{s.mutex};
+
+        std::array<std::unique_ptr<latency_histogram>, metric_names::capacity> histograms;
+        auto totals = metric_slots::collect(histograms);
+        auto names = metric_names::all();
+        auto now = std::chrono::steady_clock::now();
+
+        metrics_snapshot retval;
+        retval.interval = std::chrono::duration<double>(now - s.start).count();
+        s.start = now;
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            switch (names[i].kind) {
+                case metric_kind::counter:
+                    if (auto count = totals[i] - s.previous[i]; count > 0)
+                        retval.counters.push_back({names[i].name, count});
+                    break;
+                case metric_kind::gauge:
+                    retval.gauges.push_back({names[i].name, static_cast<std::int64_t>(totals[i])});
+                    break;
+                case metric_kind::timer:
+                    if (histograms[i]) retval.timers.push_back({names[i].name, *histograms[i]});
+                    break;
+            }
+        }
+        s.previous = totals;
+        return retval;
+    }
+
+    /// @brief Class method that takes a snapshot & hands it to the current exporter.
+    static void report()
+    {
+        auto snap = snapshot();
+        auto sink = exporter();
+        sink->write(snap);
+    }
+
+    /// @brief Class method that sets the exporter that `report` (& the background reporter) hands snapshots to.
+    static void use_exporter(std::shared_ptr<metrics_exporter> exporter)
+    {
+        auto& s = state();
+        std::scoped_lock lock{s.mutex};
+        s.exporter = exporter ? std::move(exporter) : std::make_shared<log_exporter>();
+    }
+
+    /// @brief Class method that sets the exporter back to the default one that writes to the log.
+    static void use_default_exporter() { use_exporter(nullptr); }
+
+    /// @brief Class method that returns the current exporter.
+    static std::shared_ptr<metrics_exporter> exporter()
+    {
+        auto& s = state();
+        std::scoped_lock lock{s.mutex};
+        return s.exporter;
+    }
+
+    /// @brief Class method that starts a background thread which calls `report` every so many seconds.
+    /// @note  Calling this again stops the running reporter, which reports the partial interval so far on its way out,
+    ///        & then starts a new one with the new interval. Any final partial interval is also reported at exit.
+    static void start_reporting(double seconds);
+
+    /// @brief Class method that stops the background reporter if there is one.
+    static void stop_reporting();
+
+private:
+    struct registry_state {
+        std::mutex                                        mutex;
+        std::chrono::steady_clock::time_point             start = metric_names::start();
+        std::array<std::uint64_t, metric_names::capacity> previous{}; // The totals at the previous snapshot.
+        std::shared_ptr<metrics_exporter>                 exporter = std::make_shared<log_exporter>();
+    };
+
+    static registry_state& state()
+    {
+        static registry_state retval;
+        return retval;
+    }
+};
+
+/// @brief The background thread that reports the metrics at regular intervals.
+class metrics_reporter {
+public:
+    explicit metrics_reporter(double seconds) :
+        m_interval{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(seconds))},
+        m_thread{[this] { run(); }}
+    {
+        // Empty body.
+    }
+
+    /// @brief On destruction we stop the thread which reports one last time on its way out.
+    ~metrics_reporter()
+    {
+        {
+            std::scoped_lock lock{m_mutex};
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    metrics_reporter(const metrics_reporter&) = delete;
+    metrics_reporter& operator=(const metrics_reporter&) = delete;
+
+    /// @brief The single instance (if any) that is created by `metrics_registry::start_reporting`.
+    static std::unique_ptr<metrics_reporter>& instance()
+    {
+        static std::unique_ptr<metrics_reporter> s_instance;
+        return s_instance;
+    }
+
+private:
+    std::chrono::nanoseconds m_interval;
+    std::mutex               m_mutex;
+    std::condition_variable  m_wake;
+    bool                     m_stop = false;
+    std::thread              m_thread; // Declared last so that it starts after everything else is ready.
+
+    void run()
+    {
+        std::unique_lock lock{m_mutex};
+        for (;;) {
+            auto stop = m_wake.wait_for(lock, m_interval, [this] { return m_stop; });
+            lock.unlock();
+            metrics_registry::report();
+            if (stop) return;
+            lock.lock();
+        }
+    }
+};
+
+inline void
+metrics_registry::start_reporting(double seconds)
+{
+    // The reporter reports one last time at program exit so everything it touches must be constructed first.
+    metric_names::initialize();
+    metric_slots::initialize();
+    state();
+    auto& reporter = metrics_reporter::instance();
+    reporter.reset();
+    reporter = std::make_unique<metrics_reporter>(seconds);
+}
+
+inline void
+metrics_registry::stop_reporting()
+{
+    metrics_reporter::instance().reset();
+}
+
+} // namespace utilities
@@ -0,0 +1,252 @@
+/// @brief A multi-threaded pipeline that parses the records in a text file & hands them over in batches in file order.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "stream.h"
+#include "string.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utilities {
+
+/// @brief The settings for a record parsing pipeline.
+struct pipeline_options {
+    std::string_view comment_begin = "#";   // Comments start with any of these characters (none if this is empty).
+    std::string_view delimiters = "\t,;: "; // Fields are separated by any of these characters.
+    bool             skip = true;           // By default we ignore any empty fields (e.g. two spaces in a row).
+    std::size_t      threads = 0;           // The number of worker threads -- the default 0 means one per core.
+    std::size_t      chunk_size = 1 << 20;  // The target size in bytes of each chunk of the file given to a worker.
+    std::size_t      in_flight = 0;         // Most chunks parsed ahead of the consumer -- 0 means twice the threads.
+};
+
+/// @brief The counts returned from a run of the pipeline.
+struct pipeline_stats {
+    std::size_t lines = 0;    // The 'lines' read (comments stripped, blanks skipped, continuations joined).
+    std::size_t records = 0;  // The records that were parsed & handed to the consumer.
+    std::size_t rejected = 0; // The lines the parser rejected.
+    std::size_t batches = 0;  // The number of batches handed to the consumer.
+};
+
+/// @brief A parser that turns the fields on a line into a `std::tuple<Ts...>` using `possible<T>` for each field.
+/// @note  A line is rejected unless it has exactly one field per type & every field is consumed in full by its parse.
+///        Text fields should be `std::string` as the views passed to a parser are only valid for that one call.
+template<typename... Ts>
+    requires(!(std::is_same_v<Ts, std::string_view> || ...))
+struct record_parser {
+    std::optional<std::tuple<Ts...>> operator()(std::span<const std::string_view> fields) const
+    {
+        if (fields.size() != sizeof...(Ts)) return std::nullopt;
+        return [&]<std::size_t... I>(std::index_sequence<I...>) -> std::optional<std::tuple<Ts...>> {
+            std::tuple<std::optional<Ts>...> values{field<Ts>(fields[I])...};
+            if (!(std::get<I>(values) && ...)) return std::nullopt;
+            return std::tuple<Ts...>{std::move(*std::get<I>(values))...};
+        }(std::index_sequence_for<Ts...>{});
+    }
+
+    /// @brief Class method that parses a single field as a `T`.
+    template<typename T>
+    static std::optional<T> field(std::string_view str)
+    {
+        if constexpr (std::is_same_v<T, std::string>) {
+            return std::string{str};
+        }
+        else {
+            if (str.empty()) return std::nullopt;
+            const char* next = nullptr;
+            auto        retval = possible<T>(str, &next);
+            if (next != str.data() + str.size()) return std::nullopt;
+            return retval;
+        }
+    }
+};
+
+/// @brief Parses the records in a text file on a pool of threads & hands them to a consumer in batches in file order.
+/// @param parse Called as `parse(fields)` with a `std::span<const std::string_view>` of the fields on one 'line'.
+///              It returns a `std::optional<Record>` where `std::nullopt` rejects that line.
+/// @param consume Called as `consume(batch)` with a `std::vector<Record>&` of consecutive records.
+/// @note  The file is memory-mapped & split into chunks that end on line boundaries (never inside a continuation).
+///        Workers read each chunk with the usual `read_line` semantics, split the lines into fields with
+///        `for_each_token`, and parse them. Each worker gets its own copy of `parse`. The batches are consumed on the
+///        calling thread in file order so `consume` needs no locking.
+/// @note  At most `options.in_flight` parsed chunks wait for the consumer at any one time so memory use is bounded.
+/// @throw `std::runtime_error` if the file cannot be opened. Exceptions from `parse` or `consume` are rethrown here
+///        once all the workers have stopped.
+template<typename Parser, typename Consumer>
+pipeline_stats
+parse_records(const std::filesystem::path& path, Parser parse, Consumer consume, const pipeline_options& options = {})
+{
+    using result_type = std::invoke_result_t<Parser&, std::span<const std::string_view>>;
+    using record_type = typename result_type::value_type;
+
+    mapped_file file{path};
+    auto        text = file.view();
+
+    // Does the 'line' before position `end` in the text carry on past it as a continuation?
+    auto continues = [&](std::size_t end) {
+        while (end > 0) {
+            auto nl = end > 1 ? text.rfind('\n', end - 2) : std::string_view::npos;
+            auto begin = nl == std::string_view::npos ? 0 : nl + 1;
+            auto piece = line_reader::strip(text.substr(begin, end - begin), options.comment_begin);
+            if (!piece.empty()) return piece.back() == '\\';
+            end = begin;
+        }
+        return false;
+    };
+
+    // Split the file into chunks that each end just after a newline that is not inside a run of continuations.
+    auto                          chunk_size = std::max(options.chunk_size, std::size_t{1});
+    std::vector<std::string_view> chunks;
+    for (std::size_t begin = 0; begin < text.size();) {
+        auto end = std::min(begin + chunk_size, text.size());
+        for (auto from = end - 1; end < text.size(); from = end) {
+            auto nl = text.find('\n', from);
+            end = nl == std::string_view::npos ? text.size() : nl + 1;
+            if (!continues(end)) break;
+        }
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    // Each chunk becomes one batch of records.
+    struct batch {
+        std::vector<record_type> records;
+        std::size_t              lines = 0;
+        std::size_t              rejected = 0;
+        bool                     ready = false;
+    };
+    auto process = [&options](std::string_view chunk, Parser& parser, batch& out) {
+        std::size_t                   pos = 0;
+        std::string                   scratch;
+        std::string_view              line;
+        std::vector<std::string_view> fields;
+        char_set                      delimiters{options.delimiters};
+        while (line_reader::read_line(chunk, pos, options.comment_begin, scratch, line) > 0) {
+            ++out.lines;
+            fields.clear();
+            for_each_token(line, delimiters, [&](auto tb, auto te) {
+                if (tb != te || !options.skip) fields.emplace_back(tb, te);
+            });
+            if (auto record = std::invoke(parser, std::span<const std::string_view>{fields}))
+                out.records.push_back(std::move(*record));
+            else
+                ++out.rejected;
+        }
+    };
+
+    pipeline_stats retval;
+    auto           hand_over = [&](batch& b) {
+        retval.lines += b.lines;
+        retval.records += b.records.size();
+        retval.rejected += b.rejected;
+        ++retval.batches;
+        consume(b.records);
+    };
+
+    // Small files (or a single thread) are parsed & consumed one chunk at a time on the calling thread.
+    auto threads = options.threads > 0 ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    threads = std::min(threads, chunks.size());
+    if (threads <= 1) {
+        for (auto chunk : chunks) {
+            batch b;
+            process(chunk, parse, b);
+            hand_over(b);
+        }
+        return retval;
+    }
+
+    // Otherwise the workers claim chunks in order but never get more than `in_flight` chunks ahead of the consumer.
+    auto                    in_flight = options.in_flight > 0 ? options.in_flight : 2 * threads;
+    std::vector<batch>      batches(chunks.size());
+    std::size_t             claimed = 0;
+    std::size_t             consumed = 0;
+    bool                    stop = false;
+    std::exception_ptr      error;
+    std::mutex              mutex;
+    std::condition_variable cv;
+
+    auto work = [&] {
+        Parser parser = parse;
+        while (true) {
+            std::size_t i;
+            {
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [&] { return stop || claimed == chunks.size() || claimed < consumed + in_flight; });
+                if (stop || claimed == chunks.size()) return;
+                i = claimed++;
+            }
+            try {
+                process(chunks[i], parser, batches[i]);
+            }
+            catch (...) {
+                std::scoped_lock lock{mutex};
+                if (!error) error = std::current_exception();
+                stop = true;
+                cv.notify_all();
+                return;
+            }
+            std::scoped_lock lock{mutex};
+            batches[i].ready = true;
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    auto                     halt = [&] {
+        {
+            std::scoped_lock lock{mutex};
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& worker : workers) worker.join();
+    };
+    try {
+        for (std::size_t t = 0; t < threads; ++t) workers.emplace_back(work);
+        for (std::size_t i = 0; i < batches.size(); ++i) {
+            {
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [&] { return stop || batches[i].ready; });
+                if (stop) break;
+                consumed = i + 1;
+            }
+            cv.notify_all();
+            hand_over(batches[i]);
+            batches[i] = {};
+        }
+    }
+    catch (...) {
+        halt();
+        throw;
+    }
+    halt();
+    if (error) std::rethrow_exception(error);
+    return retval;
+}
+
+/// @brief Parses the records in a text file into `std::tuple<Ts...>`'s on a pool of threads.
+/// @note  This is `parse_records(path, record_parser<Ts...>{}, consume, options)` so the lines must have exactly one
+///        field per type. For example, `parse_records<int, double>(path, consume)` for lines like "12, 3.4".
+template<typename... Ts, typename Consumer>
+pipeline_stats
+parse_records(const std::filesystem::path& path, Consumer consume, const pipeline_options& options = {})
+{
+    return parse_records(path, record_parser<Ts...>{}, std::move(consume), options);
+}
+
+} // namespace utilities
@@ -8,39 +8,174 @@
 #else
 
 // clang-format off
+#include <cstddef>
+#include <cstdio>
 #include <format>
 #include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
 // clang-format on
 
+namespace utilities {
+
+/// @brief The buffer our `std::print` workaround formats into -- it starts on the stack & moves to the heap if need be.
+/// @note  Once the output is formatted it is handed over in one go so there is just a single write per print.
+class print_buffer {
+public:
+    /// @brief An output iterator that appends characters to the buffer.
+    class iterator {
+    public:
+        using iterator_category = std::output_iterator_tag;
+        using value_type = void;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = void;
+
+        explicit iterator(print_buffer* buffer) : m_buffer{buffer} {}
+
+        iterator& operator*() { return *this; }
+        iterator& operator++() { return *this; }
+        iterator  operator++(int) { return *this; }
+        iterator& operator=(char c)
+        {
+            m_buffer->push(c);
+            return *this;
+        }
+
+    private:
+        print_buffer* m_buffer;
+    };
+
+    print_buffer() = default;
+    print_buffer(const print_buffer&) = delete;
+    print_buffer& operator=(const print_buffer&) = delete;
+
+    /// @brief Returns an output iterator that appends to the buffer.
+    iterator out() { return iterator{this}; }
+
+    /// @brief Appends a character to the buffer.
+    void push(char c)
+    {
+        if (m_size < c_capacity)
+            m_stack[m_size++] = c;
+        else
+            spill(c);
+    }
+
+    /// @brief A view of everything in the buffer.
+    std::string_view view() const { return m_heap.empty() ? std::string_view{m_stack, m_size} : m_heap; }
+
+    /// @brief Writes everything in the buffer to a C stream with a single call.
+    void write(std::FILE* stream) const
+    {
+        auto v = view();
+        std::fwrite(v.data(), 1, v.size(), stream);
+    }
+
+    /// @brief Writes everything in the buffer to a C++ stream with a single call.
+    void write(std::ostream& os) const
+    {
+        auto v = view();
+        os.write(v.data(), static_cast<std::streamsize>(v.size()));
+    }
+
+private:
+    static constexpr std::size_t c_capacity = 1024;
+
+    char        m_stack[c_capacity]; // Most output fits here.
+    std::size_t m_size = 0;          // The number of characters in the stack buffer.
+    std::string m_heap;              // Used for everything once the stack buffer is full.
+
+    void spill(char c)
+    {
+        if (m_heap.empty()) {
+            m_heap.reserve(4 * c_capacity);
+            m_heap.assign(m_stack, m_size);
+        }
+        m_heap += c;
+    }
+};
+
+} // namespace utilities
+
 namespace std {
+
+/// @brief Print to a C stream (formatting into a buffer first so we can hand the whole output over in one write).
+template<typename... Args>
+void
+print(std::FILE* stream, const format_string<Args...> format, Args&&... args)
+{
+    utilities::print_buffer buffer;
+    std::format_to(buffer.out(), format, std::forward<Args>(args)...);
+    buffer.write(stream);
+}
+
+/// @brief Print to a C stream followed by a newline -- the newline is part of the same single write.
+template<typename... Args>
+void
+println(std::FILE* stream, const format_string<Args...> format, Args&&... args)
+{
+    utilities::print_buffer buffer;
+    std::format_to(buffer.out(), format, std::forward<Args>(args)...);
+    buffer.push('\n');
+    buffer.write(stream);
+}
+
+/// @brief Print to a C++ stream (formatting into a buffer first so we can hand the whole output over in one write).
+template<typename... Args>
+void
+print(std::ostream& os, const format_string<Args...> format, Args&&... args)
+{
+    utilities::print_buffer buffer;
+    std::format_to(buffer.out(), format, std::forward<Args>(args)...);
+    buffer.write(os);
+}
+
+/// @brief Print to a C++ stream followed by a newline -- the newline is part of the same single write.
+template<typename... Args>
+void
+println(std::ostream& os, const format_string<Args...> format, Args&&... args)
+{
+    utilities::print_buffer buffer;
+    std::format_to(buffer.out(), format, std::forward<Args>(args)...);
+    buffer.push('\n');
+    buffer.write(os);
+}
+
+/// @brief Print to `stdout` -- like the real `std::print` this goes through the C stream & not `std::cout`.
 template<typename... Args>
 void
 print(const format_string<Args...> format, Args&&... args)
 {
-    std::format_to(std::ostreambuf_iterator<char>(std::cout), format, std::forward<Args>(args)...);
+    print(stdout, format, std::forward<Args>(args)...);
 }
 
+/// @brief Print to `stdout` followed by a newline.
 template<typename... Args>
 void
 println(const format_string<Args...> format, Args&&... args)
 {
-    print(format, std::forward<Args>(args)...);
-    std::cout << '\n';
+    println(stdout, format, std::forward<Args>(args)...);
 }
 
 template<typename... Args>
 void
 print(const wformat_string<Args...> format, Args&&... args)
 {
-    std::format_to(std::ostreambuf_iterator<wchar_t>(std::wcout), format, std::forward<Args>(args)...);
+    std::wstring buffer;
+    std::format_to(std::back_inserter(buffer), format, std::forward<Args>(args)...);
+    std::wcout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
 }
 
 template<typename... Args>
 void
 println(const wformat_string<Args...> format, Args&&... args)
 {
-    print(format, std::forward<Args>(args)...);
-    std::wcout << L'\n';
+    std::wstring buffer;
+    std::format_to(std::back_inserter(buffer), format, std::forward<Args>(args)...);
+    buffer += L'\n';
+    std::wcout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
 }
 } // namespace std
 
@@ -0,0 +1,268 @@
+/// @brief Simple scoped profiling zones with per-thread accumulation and a report merged across all threads.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "log.h"
+#include "macros.h"
+#include "stopwatch.h"
+#include "thread_slots.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Time everything from here to the end of the enclosing scope as the profiling zone called `name`.
+/// @note  The zone's name must have static storage duration (typically it is a string literal).
+/// @note  Like `NO_LOGS` for the logging macros, setting the `NO_PROFILE` flag at compile time removes every zone.
+#ifndef NO_PROFILE
+    #define PROFILE_SCOPE(name)                                                                                        \
+        static const utilities::profile_zone CONCAT(utilities_profile_zone_, __LINE__){                                \
+            name, __func__, utilities::message::basename(__FILE__), __LINE__};                                         \
+        const utilities::profile_guard CONCAT(utilities_profile_guard_, __LINE__)                                      \
+        {                                                                                                              \
+            CONCAT(utilities_profile_zone_, __LINE__)                                                                  \
+        }
+#else
+    #define PROFILE_SCOPE(name) void(0)
+#endif
+
+/// @brief A profiling zone that covers the rest of the enclosing function & is named after it.
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+
+namespace utilities {
+
+/// @brief The static information about a profiling zone -- these are created by the `PROFILE_SCOPE` macro.
+/// @note  Each zone gets a small integer id the first time it is reached which indexes the per-thread slots below.
+///        A zone is also a trace site so, if the tracer is recording, its visits show up on the trace timeline too.
+class profile_zone : public trace_site {
+public:
+    /// @brief The most zones we keep track of -- any past this are quietly ignored.
+    static constexpr std::size_t capacity = 256;
+
+    profile_zone(std::string_view name, std::string_view func, std::string_view file, std::size_t line) :
+        trace_site{name, func, file, line}
+    {
+        std::scoped_lock lock{mutex()};
+        m_id = zones().size();
+        zones().push_back(this);
+    }
+
+    /// @brief The index of this zone in the list of all the zones.
+    constexpr std::size_t id() const { return m_id; }
+
+    /// @brief Class method that returns a copy of the list of all the zones reached so far.
+    static std::vector<const profile_zone*> all()
+    {
+        std::scoped_lock lock{mutex()};
+        return zones();
+    }
+
+private:
+    std::size_t m_id; // Index of this zone in the list of all the zones.
+
+    static std::vector<const profile_zone*>& zones()
+    {
+        static std::vector<const profile_zone*> retval;
+        return retval;
+    }
+
+    static std::mutex& mutex()
+    {
+        static std::mutex retval;
+        return retval;
+    }
+};
+
+/// @brief The timing statistics for a single profiling zone. All times are in seconds.
+struct profile_stats {
+    std::uint64_t count = 0; // The number of times the zone was entered.
+    double        total = 0; // The total time spent in the zone.
+    double        max = 0;   // The longest single visit to the zone.
+
+    /// @brief The mean time spent in the zone per visit.
+    constexpr double mean() const { return count > 0 ? total / static_cast<double>(count) : 0; }
+
+    /// @brief Adds the statistics from another set.
+    constexpr void merge(const profile_stats& other)
+    {
+        count += other.count;
+        total += other.total;
+        max = std::max(max, other.max);
+    }
+};
+
+/// @brief The timings a thread accumulates for every zone -- `thread_slots` gives each thread its own set.
+/// @note  Only the owning thread writes to these. They are relaxed atomics so that a report can read them safely from
+///        another thread while the owner is still running. A thread that exits leaves its totals behind in the shared
+///        array of retired statistics so that later reports still include them.
+class profile_slots {
+public:
+    /// @brief Returns the slots for the calling thread.
+    static profile_slots& local() { return registry::local(); }
+
+    /// @brief Record a visit to a zone (only ever called by the owning thread).
+    void record(std::size_t id, double seconds)
+    {
+        if (id >= profile_zone::capacity) return;
+        auto& slot = m_slots[id];
+        slot.count.store(slot.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        slot.total.store(slot.total.load(std::memory_order_relaxed) + seconds, std::memory_order_relaxed);
+        if (seconds > slot.max.load(std::memory_order_relaxed)) slot.max.store(seconds, std::memory_order_relaxed);
+    }
+
+    /// @brief Class method that merges the statistics for all the zones across all the threads, past and present.
+    static std::vector<profile_stats> merged()
+    {
+        return registry::visit([](const retired_stats& retired, const auto& live) {
+            std::vector<profile_stats> retval(retired.begin(), retired.end());
+            for (const auto* slots : live)
+                for (std::size_t i = 0; i < profile_zone::capacity; ++i) retval[i].merge(slots->stats(i));
+            return retval;
+        });
+    }
+
+    /// @brief Class method that zeros all the statistics -- best called when no zones are being timed.
+    static void reset()
+    {
+        registry::visit([](retired_stats& retired, const auto& live) {
+            retired = {};
+            for (auto* slots : live) {
+                for (auto& slot : slots->m_slots) {
+                    slot.count.store(0, std::memory_order_relaxed);
+                    slot.total.store(0, std::memory_order_relaxed);
+                    slot.max.store(0, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    profile_slots(const profile_slots&) = delete;
+    profile_slots& operator=(const profile_slots&) = delete;
+
+private:
+    using retired_stats = std::array<profile_stats, profile_zone::capacity>;
+    using registry = thread_slots<profile_slots, retired_stats>;
+    friend registry;
+
+    struct zone_slot {
+        std::atomic<std::uint64_t> count = 0;
+        std::atomic<double>        total = 0;
+        std::atomic<double>        max = 0;
+    };
+    std::array<zone_slot, profile_zone::capacity> m_slots;
+
+    profile_slots() = default;
+
+    profile_stats stats(std::size_t id) const
+    {
+        const auto& s = m_slots[id];
+        return {s.count.load(std::memory_order_relaxed), s.total.load(std::memory_order_relaxed),
+                s.max.load(std::memory_order_relaxed)};
+    }
+
+    // Called with the registry locked as the owning thread exits.
+    void retire_into(retired_stats& retired) const
+    {
+        for (std::size_t i = 0; i < profile_zone::capacity; ++i) retired[i].merge(stats(i));
+    }
+};
+
+/// @brief An RAII guard that times its own lifetime & records that as a visit to a zone.
+/// @note  These are created by the `PROFILE_SCOPE` macro. Timing uses the cheap cycle counter clock.
+class profile_guard {
+public:
+    explicit profile_guard(const profile_zone& zone) : m_id{zone.id()}, m_trace{zone} {}
+    ~profile_guard() { profile_slots::local().record(m_id, m_stopwatch.elapsed()); }
+
+    profile_guard(const profile_guard&) = delete;
+    profile_guard& operator=(const profile_guard&) = delete;
+
+private:
+    std::size_t     m_id;        // The id of the zone we are timing.
+    trace_guard     m_trace;     // Records the visit on the trace timeline if the tracer is recording.
+    cycle_stopwatch m_stopwatch; // Started on construction.
+};
+
+/// @brief A report of the timing statistics for every profiling zone merged across all threads.
+class profile_report {
+public:
+    /// @brief One row of the report.
+    struct entry {
+        const profile_zone* zone;
+        profile_stats       stats;
+    };
+
+    /// @brief Construct a report from the statistics gathered so far -- rows are sorted by total time, largest first.
+    profile_report()
+    {
+        auto stats = profile_slots::merged();
+        for (const auto* zone : profile_zone::all()) {
+            if (zone->id() < stats.size() && stats[zone->id()].count > 0)
+                m_entries.push_back({zone, stats[zone->id()]});
+        }
+        std::sort(m_entries.begin(), m_entries.end(),
+                  [](const auto& a, const auto& b) { return a.stats.total > b.stats.total; });
+    }
+
+    /// @brief Read-only access to the rows of the report.
+    const std::vector<entry>& entries() const { return m_entries; }
+
+    /// @brief Returns the report as a table with one row per zone.
+    std::string to_string() const
+    {
+        std::size_t name_width = 4, where_width = 8;
+        std::vector<std::string> where;
+        for (const auto& e : m_entries) {
+            where.push_back(std::format("{} ({}:{})", e.zone->function(), e.zone->filename(), e.zone->line()));
+            name_width = std::max(name_width, e.zone->name().size());
+            where_width = std::max(where_width, where.back().size());
+        }
+
+        auto retval = std::format("{:<{}}  {:<{}}  {:>10}  {:>10}  {:>10}  {:>10}\n", "Zone", name_width, "Location",
+                                  where_width, "Count", "Total", "Mean", "Max");
+        for (std::size_t i = 0; i < m_entries.size(); ++i) {
+            const auto& [zone, stats] = m_entries[i];
+            retval += std::format("{:<{}}  {:<{}}  {:>10}  {:>10}  {:>10}  {:>10}\n", zone->name(), name_width,
+                                  where[i], where_width, stats.count, duration_string(stats.total),
+                                  duration_string(stats.mean()), duration_string(stats.max));
+        }
+        return retval;
+    }
+
+private:
+    std::vector<entry> m_entries;
+};
+
+/// @brief Usual output operator prints the report as a table.
+inline std::ostream&
+operator<<(std::ostream& os, const profile_report& rhs)
+{
+    return os << rhs.to_string();
+}
+
+/// @brief Returns a report of all the profiling zones merged across all threads so far.
+inline profile_report
+profile()
+{
+    return profile_report{};
+}
+
+/// @brief Zeros the statistics for all the profiling zones -- best called when no zones are being timed.
+inline void
+reset_profile()
+{
+    profile_slots::reset();
+}
+
+} // namespace utilities
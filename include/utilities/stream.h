@@ -4,8 +4,39 @@
 /// SPDX-License-Identifier: MIT
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory_resource>
+#include <ranges>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define UTILITIES_HAVE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define UTILITIES_HAVE_NEON
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define UTILITIES_HAVE_MMAP
+#endif
 
 namespace utilities {
 
@@ -16,12 +47,15 @@ namespace utilities {
 /// @param  line We overwrite this with the content we read from the input stream.
 /// @param  comment_begin We ignore/strip out comments that start with this character ("#" by default).
 /// @return The number of characters read.
+/// @note   The line can be any `std::basic_string` of `char`s so a `std::pmr::string` in an arena works too.
 /// @todo   In the code below we should escape comment delimiters that are special (e.g. '*')
-static std::size_t
-read_line(std::istream& s, std::string& line, std::string_view comment_begin = "#")
+template<typename Alloc>
+std::size_t
+read_line(std::istream& s, std::basic_string<char, std::char_traits<char>, Alloc>& line,
+          std::string_view comment_begin = "#")
 {
     // Lambda that trims a string in-place from leading/trailing space characters.
-    auto trim = [](std::string& str) {
+    auto trim = [](auto& str) {
         str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](int ch) { return !std::isspace(ch); }));
         str.erase(std::find_if(str.rbegin(), str.rend(), [](int ch) { return !std::isspace(ch); }).base(), str.end());
     };
@@ -57,7 +91,7 @@ read_line(std::istream& s, std::string& line, std::string_view comment_begin = "
             trim(line);
 
             // Recurse ...
-            std::string continuation;
+            std::basic_string<char, std::char_traits<char>, Alloc> continuation{line.get_allocator()};
             read_line(s, continuation, comment_begin);
             if (!continuation.empty()) {
                 line += " ";
@@ -86,6 +120,16 @@ read_line(std::istream& s, std::string_view comment_begin = "#")
     return retval;
 }
 
+/// @brief Reads one 'line' from a stream and returns that as a new string allocated from a memory resource.
+/// @param mr For example, a `std::pmr::monotonic_buffer_resource` that holds all the lines for a request or batch.
+inline std::pmr::string
+read_line(std::istream& s, std::string_view comment_begin, std::pmr::memory_resource* mr)
+{
+    std::pmr::string retval{mr};
+    read_line(s, retval, comment_begin);
+    return retval;
+}
+
 /// @brief Rewind an input stream to the start
 inline std::istream&
 rewind(std::istream& is)
@@ -113,4 +157,377 @@ line_count(std::istream& is, std::string_view comment_begin = "#")
     return retval;
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+// Reading large files without copying ...
+// --------------------------------------------------------------------------------------------------------------------
+
+/// @brief A read-only view of the entire contents of a file.
+/// @note  On POSIX systems the file is memory-mapped so nothing is copied. Elsewhere we read it into memory in one go.
+/// @throw `std::runtime_error` if the file cannot be opened or mapped.
+class mapped_file {
+public:
+    explicit mapped_file(const std::filesystem::path& path)
+    {
+#ifdef UTILITIES_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Failed to open file '" + path.string() + "'");
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to get the size of file '" + path.string() + "'");
+        }
+        m_size = static_cast<std::size_t>(info.st_size);
+        if (m_size > 0) {
+            void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Failed to memory-map file '" + path.string() + "'");
+            }
+            ::madvise(addr, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(addr);
+        }
+        ::close(fd);
+#else
+        std::ifstream file{path, std::ios::binary};
+        if (!file) throw std::runtime_error("Failed to open file '" + path.string() + "'");
+        m_buffer.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#endif
+    }
+
+    ~mapped_file()
+    {
+#ifdef UTILITIES_HAVE_MMAP
+        if (m_data) ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    /// @brief The contents of the file.
+    std::string_view view() const { return {m_data, m_size}; }
+
+    /// @brief The number of bytes in the file.
+    std::size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr; // Start of the file contents.
+    std::size_t m_size = 0;       // Number of bytes in the file.
+#ifndef UTILITIES_HAVE_MMAP
+    std::string m_buffer; // Where the file contents live if we cannot memory-map the file.
+#endif
+};
+
+/// @brief Reads 'lines' from a file with the same semantics as `read_line` but without copying or allocating.
+/// @note  Lines are returned as views into the memory-mapped file which stay valid until the next read. Only if a line
+///        has a continuation do we join the pieces together in a scratch buffer that is reused from line to line.
+/// @throw `std::runtime_error` if the file cannot be opened.
+class line_reader {
+public:
+    /// @brief Opens a file for reading -- comments start with any character in `comment_begin` ("#" by default).
+    explicit line_reader(const std::filesystem::path& path, std::string_view comment_begin = "#") :
+        m_file{path}, m_text{m_file.view()}, m_comment_begin{comment_begin}
+    {}
+
+    /// @brief Reads the next 'line' from the file stripping comments, skipping blanks, & joining continuation lines.
+    /// @param line We overwrite this with a view of the content -- valid until the next read.
+    /// @return The number of characters in `line` (zero once we get to the end of the file).
+    std::size_t read_line(std::string_view& line)
+    {
+        return read_line(m_text, m_pos, m_comment_begin, m_scratch, line);
+    }
+
+    /// @brief Class method that reads the next 'line' from a block of text with the same semantics.
+    /// @param text The text we are reading lines from.
+    /// @param pos Where we are in the text -- this is advanced past the line we read.
+    /// @param comment_begin Comments start with any of these characters.
+    /// @param scratch Buffer used to join up continuation lines -- reuse it from line to line to avoid allocations.
+    /// @param line We overwrite this with a view of the content -- valid until the next read.
+    /// @return The number of characters in `line` (zero once we get to the end of the text).
+    static std::size_t read_line(std::string_view text, std::size_t& pos, std::string_view comment_begin,
+                                 std::string& scratch, std::string_view& line)
+    {
+        line = {};
+        while (pos < text.size()) {
+            auto piece = next_piece(text, pos, comment_begin);
+            if (piece.empty()) continue;
+            if (piece.back() != '\\') {
+                line = piece;
+                return line.size();
+            }
+
+            // A continuation: join the pieces (minus the backslashes) with single spaces until one doesn't continue.
+            // NOTE: This matches `read_line(std::istream&, ...)` exactly -- blank lines in between are skipped.
+            scratch.assign(trim(piece.substr(0, piece.size() - 1)));
+            auto committed = scratch.size();
+            while (pos < text.size()) {
+                piece = next_piece(text, pos, comment_begin);
+                if (piece.empty()) continue;
+                bool more = piece.back() == '\\';
+                if (more) piece = trim(piece.substr(0, piece.size() - 1));
+                scratch += ' ';
+                scratch += piece;
+                if (!piece.empty()) committed = scratch.size();
+                if (!more) break;
+            }
+            scratch.resize(committed);
+            if (!scratch.empty()) {
+                line = scratch;
+                return line.size();
+            }
+        }
+        return 0;
+    }
+
+    /// @brief Have we read everything in the file?
+    bool eof() const { return m_pos >= m_text.size(); }
+
+    /// @brief Go back to the start of the file.
+    void rewind() { m_pos = 0; }
+
+    /// @brief Class method that strips any comment from one physical line & then trims it of white space.
+    static std::string_view strip(std::string_view line, std::string_view comment_begin)
+    {
+        // The usual case is a single comment character which we can look for a lot faster.
+        if (comment_begin.size() == 1) {
+            auto hash = static_cast<const char*>(std::memchr(line.data(), comment_begin[0], line.size()));
+            if (hash) line = line.substr(0, static_cast<std::size_t>(hash - line.data()));
+        }
+        else if (!comment_begin.empty()) {
+            line = line.substr(0, line.find_first_of(comment_begin));
+        }
+        return trim(line);
+    }
+
+    /// @brief Class method that trims leading & trailing white space (the same characters as `std::isspace` uses).
+    static std::string_view trim(std::string_view str)
+    {
+        auto is_space = [](char ch) { return ch == ' ' || (ch >= '\t' && ch <= '\r'); };
+        while (!str.empty() && is_space(str.front())) str.remove_prefix(1);
+        while (!str.empty() && is_space(str.back())) str.remove_suffix(1);
+        return str;
+    }
+
+private:
+    mapped_file      m_file;          // The file contents.
+    std::string_view m_text;          // View of the file contents.
+    std::string_view m_comment_begin; // Comments start with any of these characters.
+    std::size_t      m_pos = 0;       // Where we are in the file.
+    std::string      m_scratch;       // Where we join up continuation lines.
+
+    // The next physical line in some text with any comment stripped & trimmed of white space.
+    static std::string_view next_piece(std::string_view text, std::size_t& pos, std::string_view comment_begin)
+    {
+        auto rest = text.substr(pos);
+        auto nl = static_cast<const char*>(std::memchr(rest.data(), '\n', rest.size()));
+        auto len = nl ? static_cast<std::size_t>(nl - rest.data()) : rest.size();
+        pos += nl ? len + 1 : len;
+        return strip(rest.substr(0, len), comment_begin);
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Ranges over the lines from a source ...
+// --------------------------------------------------------------------------------------------------------------------
+
+/// @brief An input range over the 'lines' read from an input stream or a `line_reader`.
+/// @note  The lines have the usual `read_line` semantics & each is a `std::string_view` that is only valid until the
+///        iterator is advanced. For streams we reuse a single internal buffer so there are no per-line allocations.
+template<typename Source>
+    requires std::is_same_v<Source, std::istream> || std::is_same_v<Source, line_reader>
+class lines_view : public std::ranges::view_interface<lines_view<Source>> {
+public:
+    /// @brief The iterators just advance the view they came from.
+    class iterator {
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(lines_view* view) : m_view{view} {}
+
+        std::string_view operator*() const { return m_view->m_line; }
+
+        iterator& operator++()
+        {
+            m_view->next();
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) { return it.done(); }
+
+    private:
+        lines_view* m_view = nullptr;
+
+        bool done() const { return !m_view || m_view->m_done; }
+    };
+
+    lines_view() = default;
+    explicit lines_view(Source& source, std::string_view comment_begin = "#") :
+        m_source{&source}, m_comment_begin{comment_begin}
+    {}
+
+    /// @brief Reads the first line -- like any input range you can only iterate through the lines once.
+    iterator begin()
+    {
+        next();
+        return iterator{this};
+    }
+
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+private:
+    Source*          m_source = nullptr; // Where the lines come from.
+    std::string_view m_comment_begin;    // For streams: comments start with any of these characters.
+    std::string      m_buffer;           // For streams: the buffer we reuse for every line.
+    std::string_view m_line;             // The current line.
+    bool             m_done = false;     // Have we run out of lines?
+
+    void next()
+    {
+        if constexpr (std::is_same_v<Source, std::istream>) {
+            m_done = read_line(*m_source, m_buffer, m_comment_begin) == 0;
+            m_line = m_buffer;
+        }
+        else {
+            m_done = m_source->read_line(m_line) == 0;
+        }
+    }
+};
+
+/// @brief Returns an input range over the 'lines' in a stream e.g. `for (auto line : lines(file)) ...`
+/// @param comment_begin We ignore/strip out comments that start with this character ("#" by default).
+inline lines_view<std::istream>
+lines(std::istream& is, std::string_view comment_begin = "#")
+{
+    return lines_view<std::istream>{is, comment_begin};
+}
+
+/// @brief Returns an input range over the 'lines' from a memory-mapped `line_reader` (nothing is copied).
+inline lines_view<line_reader>
+lines(line_reader& reader)
+{
+    return lines_view<line_reader>{reader};
+}
+
+/// @brief Counts the newline characters in a block of memory (vectorised where we can).
+inline std::size_t
+newline_count(std::string_view text)
+{
+    std::size_t retval = 0;
+    std::size_t i = 0;
+#if defined(UTILITIES_HAVE_SSE2)
+    // Compare 16 bytes at a time & count the matches from the bit mask.
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= text.size(); i += 16) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, nl)));
+        retval += static_cast<std::size_t>(std::popcount(mask));
+    }
+#elif defined(UTILITIES_HAVE_NEON)
+    // Compare 16 bytes at a time -- matches are 0xFF so subtracting them counts them (flushed before they can wrap).
+    const uint8x16_t nl = vdupq_n_u8('\n');
+    while (i + 16 <= text.size()) {
+        uint8x16_t  acc = vdupq_n_u8(0);
+        std::size_t end = std::min(text.size() - 15, i + 255 * 16);
+        for (; i < end; i += 16) {
+            auto block = vld1q_u8(reinterpret_cast<const std::uint8_t*>(text.data() + i));
+            acc = vsubq_u8(acc, vceqq_u8(block, nl));
+        }
+        retval += vaddlvq_u8(acc);
+    }
+#endif
+    for (; i < text.size(); ++i) retval += text[i] == '\n';
+    return retval;
+}
+
+/// @brief Counts the 'lines' in a file using all the available cores.
+/// @note  If the comment start string is empty we count the lines just as `std::getline` would see them. Otherwise, we
+///        count the lines `read_line` would return, so comment lines, blank lines, & continuations are accounted for.
+/// @param threads The number of threads to use -- the default 0 means one per core (small files just use one).
+/// @throw `std::runtime_error` if the file cannot be opened.
+inline std::size_t
+line_count(const std::filesystem::path& path, std::string_view comment_begin = "#", std::size_t threads = 0)
+{
+    mapped_file file{path};
+    auto        text = file.view();
+    if (text.empty()) return 0;
+
+    // Each chunk of the file gets summarised independently.
+    // A line (as seen by `read_line`) ends at a non-empty piece that doesn't end with a continuation character.
+    // Content in an unterminated run of continuations at the end of a chunk only counts if it ends the whole file.
+    struct summary {
+        std::size_t count = 0;        // Lines counted in the chunk.
+        bool        finished = false; // Does the chunk have a line that ended (so earlier continuations are done)?
+        bool        trailing = false; // Is there content in continuations after the last line that ended in the chunk?
+    };
+    auto summarise = [comment_begin](std::string_view chunk) {
+        summary retval;
+        if (comment_begin.empty()) {
+            retval.count = newline_count(chunk);
+            return retval;
+        }
+        while (!chunk.empty()) {
+            auto nl = static_cast<const char*>(std::memchr(chunk.data(), '\n', chunk.size()));
+            auto len = nl ? static_cast<std::size_t>(nl - chunk.data()) : chunk.size();
+            auto piece = line_reader::strip(chunk.substr(0, len), comment_begin);
+            chunk.remove_prefix(nl ? len + 1 : len);
+            if (piece.empty()) continue;
+            if (piece.back() != '\\') {
+                ++retval.count;
+                retval.finished = true;
+                retval.trailing = false;
+            }
+            else if (!line_reader::trim(piece.substr(0, piece.size() - 1)).empty()) {
+                retval.trailing = true;
+            }
+        }
+        return retval;
+    };
+
+    // Split the file into chunks that each end just after a newline (small files are done in one go).
+    constexpr std::size_t min_chunk = 1 << 20;
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+    threads = std::clamp<std::size_t>(text.size() / min_chunk, 1, threads);
+    std::vector<std::string_view> chunks;
+    for (std::size_t begin = 0; begin < text.size();) {
+        auto end = std::min(begin + text.size() / threads + 1, text.size());
+        auto nl = text.find('\n', end - 1);
+        end = nl == std::string_view::npos ? text.size() : nl + 1;
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    std::vector<summary> summaries(chunks.size());
+    if (chunks.size() == 1) {
+        summaries[0] = summarise(chunks[0]);
+    }
+    else {
+        std::vector<std::thread> workers;
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+            workers.emplace_back([&, i] { summaries[i] = summarise(chunks[i]); });
+        for (auto& worker : workers) worker.join();
+    }
+
+    // Merge the summaries.
+    std::size_t retval = 0;
+    for (const auto& s : summaries) retval += s.count;
+    if (comment_begin.empty()) {
+        // Like `std::getline` we count a final line that has no newline.
+        if (text.back() != '\n') ++retval;
+    }
+    else {
+        // A run of continuations at the end of the file makes one more line if it has any content.
+        for (auto s = summaries.rbegin(); s != summaries.rend(); ++s) {
+            if (s->trailing) ++retval;
+            if (s->trailing || s->finished) break;
+        }
+    }
+    return retval;
+}
+
 } // namespace utilities
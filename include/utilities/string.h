@@ -5,54 +5,160 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cctype>
 #include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <format>
+#include <functional>
+#include <initializer_list>
 #include <iterator>
+#include <limits>
+#include <locale>
+#include <memory_resource>
 #include <optional>
 #include <ranges>
 #include <regex>
+#include <span>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define UTILITIES_HAVE_AVX2
+#endif
+#if defined(__SSSE3__) || defined(__AVX2__)
+    #include <tmmintrin.h>
+    #define UTILITIES_HAVE_SSSE3
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define UTILITIES_HAVE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define UTILITIES_HAVE_NEON
+#endif
+
 namespace utilities {
 
+/// @brief Flips the case of the 26 ASCII letters starting at `first` in a block of memory (16 or 32 bytes per step).
+/// @note  Pass 'a' to convert to upper case or 'A' to convert to lower case. All other bytes are left alone so this is
+///        safe on UTF-8 text. The instruction set is picked at compile time (AVX2, SSE2, or NEON with a scalar tail).
+inline void
+flip_ascii_case(char* data, std::size_t size, char first)
+{
+    std::size_t i = 0;
+#if defined(UTILITIES_HAVE_AVX2) || defined(UTILITIES_HAVE_SSE2)
+    // Shift the bytes so `first` lands on -128 -- then the letters are the bytes that are (signed) less than -102.
+    const auto shift = static_cast<char>(-128 - first);
+    const auto limit = static_cast<char>(-128 + 26);
+#endif
+#if defined(UTILITIES_HAVE_AVX2)
+    const __m256i shift32 = _mm256_set1_epi8(shift), limit32 = _mm256_set1_epi8(limit), flip32 = _mm256_set1_epi8(0x20);
+    for (; i + 32 <= size; i += 32) {
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        auto letters = _mm256_cmpgt_epi8(limit32, _mm256_add_epi8(block, shift32));
+        block = _mm256_xor_si256(block, _mm256_and_si256(letters, flip32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), block);
+    }
+#endif
+#if defined(UTILITIES_HAVE_SSE2)
+    const __m128i shift16 = _mm_set1_epi8(shift), limit16 = _mm_set1_epi8(limit), flip16 = _mm_set1_epi8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        auto letters = _mm_cmplt_epi8(_mm_add_epi8(block, shift16), limit16);
+        block = _mm_xor_si128(block, _mm_and_si128(letters, flip16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), block);
+    }
+#elif defined(UTILITIES_HAVE_NEON)
+    // Unsigned compare: the letters are the bytes that are less than 26 once we subtract `first`.
+    const uint8x16_t first16 = vdupq_n_u8(static_cast<std::uint8_t>(first));
+    const uint8x16_t limit16 = vdupq_n_u8(26), flip16 = vdupq_n_u8(0x20);
+    for (; i + 16 <= size; i += 16) {
+        auto block = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data + i));
+        auto letters = vcltq_u8(vsubq_u8(block, first16), limit16);
+        vst1q_u8(reinterpret_cast<std::uint8_t*>(data + i), veorq_u8(block, vandq_u8(letters, flip16)));
+    }
+#endif
+    for (; i < size; ++i) {
+        if (static_cast<unsigned char>(data[i] - first) < 26) data[i] = static_cast<char>(data[i] ^ 0x20);
+    }
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 // We start with the convert-an-input-string-in-place versions which only work on *non-const* input strings.
 // --------------------------------------------------------------------------------------------------------------------
+/// @brief A `std::basic_string` of `char`s with any allocator e.g. a `std::string` or a `std::pmr::string`.
+/// @note  The in-place functions take any of these so they work just as well on strings that live in an arena.
+template<typename String>
+concept char_string =
+    std::same_as<String, std::basic_string<char, std::char_traits<char>, typename String::allocator_type>>;
+
 /// @brief Converts a string to upper case in-place.
-/// @note  Uses the standard C-library @c toupper(...) function (so will not work for wide character sets).
-inline void
-upper_case(std::string& str)
+/// @note  Only the ASCII letters are converted which is done many bytes at a time (see `flip_ascii_case`).
+template<char_string String>
+void
+upper_case(String& str)
 {
-    std::transform(str.begin(), str.end(), str.begin(), [](int c) { return static_cast<char>(std::toupper(c)); });
+    flip_ascii_case(str.data(), str.size(), 'a');
 }
 
 /// @brief Converts a string to lower case in place.
-/// @note  Uses the standard C-library @c tolower(...) function (so will not work for wide character sets).
-inline void
-lower_case(std::string& str)
+/// @note  Only the ASCII letters are converted which is done many bytes at a time (see `flip_ascii_case`).
+template<char_string String>
+void
+lower_case(String& str)
+{
+    flip_ascii_case(str.data(), str.size(), 'A');
+}
+
+/// @brief Converts a string to upper case in-place using the rules of a particular locale.
+/// @note  Much slower than the ASCII version but it handles any single byte character set the locale knows about.
+template<char_string String>
+void
+upper_case(String& str, const std::locale& loc)
+{
+    std::use_facet<std::ctype<char>>(loc).toupper(str.data(), str.data() + str.size());
+}
+
+/// @brief Converts a string to lower case in-place using the rules of a particular locale.
+/// @note  Much slower than the ASCII version but it handles any single byte character set the locale knows about.
+template<char_string String>
+void
+lower_case(String& str, const std::locale& loc)
 {
-    std::transform(str.begin(), str.end(), str.begin(), [](int c) { return static_cast<char>(::tolower(c)); });
+    std::use_facet<std::ctype<char>>(loc).tolower(str.data(), str.data() + str.size());
 }
 
 /// @brief Removes any leading white-space from a string in-place
-inline void
-trim_left(std::string& str)
+template<char_string String>
+void
+trim_left(String& str)
 {
     str.erase(str.begin(), std::find_if(str.begin(), str.end(), [](int ch) { return !std::isspace(ch); }));
 }
 
 /// @brief Remove any trailing white-space from a string in-place.
-inline void
-trim_right(std::string& str)
+template<char_string String>
+void
+trim_right(String& str)
 {
     str.erase(std::find_if(str.rbegin(), str.rend(), [](int ch) { return !std::isspace(ch); }).base(), str.end());
 }
 
 /// @brief Removes all leading & trailing white-space from a string in-place.
-inline void
-trim(std::string& str)
+template<char_string String>
+void
+trim(String& str)
 {
     trim_left(str);
     trim_right(str);
@@ -62,8 +168,9 @@ trim(std::string& str)
 /// @param str string to be be converted.
 /// @param target the target substring to hunt for.
 /// @param replacement what we replace the first occurrence of the target with.
-inline void
-replace_left(std::string& str, std::string_view target, std::string_view replacement)
+template<char_string String>
+void
+replace_left(String& str, std::string_view target, std::string_view replacement)
 {
     auto p = str.find(target);
     if (p != std::string::npos) str.replace(p, target.length(), replacement);
@@ -73,42 +180,145 @@ replace_left(std::string& str, std::string_view target, std::string_view replace
 /// @param str string to be be converted.
 /// @param target the target substring to hunt for.
 /// @param replacement what we replace the last occurrence of the target with.
-inline void
-replace_right(std::string& str, std::string_view target, std::string_view replacement)
+template<char_string String>
+void
+replace_right(String& str, std::string_view target, std::string_view replacement)
 {
     auto p = str.rfind(target);
     if (p != std::string::npos) str.replace(p, target.length(), replacement);
 }
 
+/// @brief Calls `f(pos)` with the position of each non-overlapping occurrence of a target in some text (left to right).
+/// @note  Longer targets are found using a Boyer-Moore-Horspool searcher which skips through the text in big strides.
+///        Shorter ones use `std::string_view::find` which hunts for the first character with @c memchr(...).
+template<typename Func>
+void
+for_each_match(std::string_view text, std::string_view target, Func f)
+{
+    if (target.empty()) return;
+    if (target.size() >= 8) {
+        std::boyer_moore_horspool_searcher searcher{target.begin(), target.end()};
+        for (auto it = text.begin();;) {
+            auto [b, e] = searcher(it, text.end());
+            if (b == text.end()) return;
+            f(static_cast<std::size_t>(b - text.begin()));
+            it = e;
+        }
+    }
+    else {
+        for (auto p = text.find(target); p != std::string_view::npos; p = text.find(target, p + target.size())) f(p);
+    }
+}
+
 /// @brief Replace all occurrences of a target substring with some other string in-place.
 /// @param str string to be be converted.
 /// @param target the target substring to hunt for.
 /// @param replacement what we replace all occurrences of the target with.
-inline void
-replace(std::string& str, std::string_view target, std::string_view replacement)
+/// @note  This is linear in the size of the string. If the replacement is no longer than the target then we compact
+///        the string where it is, otherwise we build the result in a new buffer that is sized just once.
+template<char_string String>
+void
+replace(String& str, std::string_view target, std::string_view replacement)
 {
-    std::size_t p = 0;
-    while ((p = str.find(target, p)) != std::string::npos) {
-        str.replace(p, target.length(), replacement);
-        p += replacement.length();
+    if (target.empty()) return;
+
+    // Compact in place -- the write position can never overtake the read position.
+    if (replacement.size() <= target.size()) {
+        std::size_t read = 0, write = 0;
+        for_each_match(str, target, [&](std::size_t p) {
+            if (write != read) std::memmove(str.data() + write, str.data() + read, p - read);
+            write += p - read;
+            std::memcpy(str.data() + write, replacement.data(), replacement.size());
+            write += replacement.size();
+            read = p + target.size();
+        });
+        if (read == 0) return;
+        std::memmove(str.data() + write, str.data() + read, str.size() - read);
+        str.resize(write + str.size() - read);
+        return;
     }
+
+    // The string grows so we find all the matches first & then build the result in one go.
+    std::vector<std::size_t> matches;
+    for_each_match(str, target, [&](std::size_t p) { matches.push_back(p); });
+    if (matches.empty()) return;
+    String retval{str.get_allocator()};
+    retval.reserve(str.size() + matches.size() * (replacement.size() - target.size()));
+    std::size_t read = 0;
+    for (auto p : matches) {
+        retval.append(str, read, p - read);
+        retval += replacement;
+        read = p + target.size();
+    }
+    retval.append(str, read);
+    str = std::move(retval);
+}
+
+/// @brief Is a character white space? These are the same characters @c std::isspace(...) uses in the "C" locale.
+constexpr bool
+is_space(char ch)
+{
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
 }
 
 /// @brief Replace all contiguous white space sequences in a string in-place.
 /// @param with By default they are replaced with a single space character
 /// @param also_trim By default any white space at the beginning and end is removed entirely
-inline void
-replace_space(std::string& s, const std::string& with = " ", bool also_trim = true)
+/// @note  This is one linear pass. If `with` is at most one character the string is compacted where it is without
+///        allocating. Otherwise the result can grow so it is built in a single new buffer of exactly the right size.
+template<char_string String>
+void
+replace_space(String& s, std::string_view with = " ", bool also_trim = true)
 {
-    if (also_trim) trim(s);
-    std::regex ws{R"(\s+)"};
-    s = std::regex_replace(s, ws, with);
+    std::size_t b = 0, e = s.size();
+    if (also_trim) {
+        while (b < e && is_space(s[b])) ++b;
+        while (e > b && is_space(s[e - 1])) --e;
+    }
+
+    // Common case: compact the string in place -- the write position can never overtake the read position.
+    if (with.size() <= 1) {
+        std::size_t out = 0;
+        for (std::size_t i = b; i < e;) {
+            if (is_space(s[i])) {
+                while (i < e && is_space(s[i])) ++i;
+                if (!with.empty()) s[out++] = with[0];
+            }
+            else {
+                s[out++] = s[i++];
+            }
+        }
+        s.resize(out);
+        return;
+    }
+
+    // Otherwise count the runs of white space so we can allocate the result just once.
+    std::size_t runs = 0, spaces = 0;
+    for (std::size_t i = b; i < e; ++i) {
+        if (is_space(s[i])) {
+            ++spaces;
+            if (i == b || !is_space(s[i - 1])) ++runs;
+        }
+    }
+    String retval{s.get_allocator()};
+    retval.reserve(e - b - spaces + runs * with.size());
+    for (std::size_t i = b; i < e;) {
+        if (is_space(s[i])) {
+            while (i < e && is_space(s[i])) ++i;
+            retval += with;
+        }
+        else {
+            retval += s[i++];
+        }
+    }
+    s = std::move(retval);
 }
 
 /// @brief Condense contiguous white space sequences in a string in-place.
 /// @param also_trim By default any white space at the beginning and end is removed entirely
-inline void
-condense(std::string& s, bool also_trim = true)
+template<char_string String>
+void
+condense(String& s, bool also_trim = true)
 {
     replace_space(s, " ", also_trim);
 }
@@ -116,8 +326,9 @@ condense(std::string& s, bool also_trim = true)
 /// @brief Erase the first occurrence of a target substring.
 /// @param str string to be be converted.
 /// @param target the target substring to hunt for.
-inline void
-erase_left(std::string& str, std::string_view target)
+template<char_string String>
+void
+erase_left(String& str, std::string_view target)
 {
     auto p = str.find(target);
     if (p != std::string::npos) str.erase(p, target.length());
@@ -126,8 +337,9 @@ erase_left(std::string& str, std::string_view target)
 /// @brief Erase the last occurrence of a target substring.
 /// @param str string to be be converted.
 /// @param target the target substring to hunt for.
-inline void
-erase_right(std::string& str, std::string_view target)
+template<char_string String>
+void
+erase_right(String& str, std::string_view target)
 {
     auto p = str.rfind(target);
     if (p != std::string::npos) str.erase(p, target.length());
@@ -136,68 +348,133 @@ erase_right(std::string& str, std::string_view target)
 /// @brief Erase all occurrences of a target substring.
 /// @param str string to be be converted.
 /// @param target the target substring to hunt for.
+/// @note  This is linear in the size of the string as everything is shifted into place just the once.
+///        Unlike its neighbours this isn't a template as it would then be ambiguous with `std::erase` for strings.
 inline void
 erase(std::string& str, std::string_view target)
 {
-    std::size_t p = 0;
-    while ((p = str.find(target, p)) != std::string::npos) str.erase(p, target.length());
+    replace(str, target, "");
+}
+
+/// @brief Erase all occurrences of a target substring from a string that lives in a memory resource.
+inline void
+erase(std::pmr::string& str, std::string_view target)
+{
+    replace(str, target, "");
+}
+
+/// @brief Checks whether a pair of characters "surround" some text e.g. '(' and ')' or '*' and '*'.
+/// @note  An alpha-numeric first character never opens a surround.
+inline bool
+is_surround(char first, char last)
+{
+    if (std::isalnum(static_cast<unsigned char>(first))) return false;
+    switch (first) {
+        case '(': return last == ')';
+        case '[': return last == ']';
+        case '{': return last == '}';
+        case '<': return last == '>';
+        default: return last == first;
+    }
 }
 
 /// @brief Removes "surrounds" from a @c std::string so for example: (text) -> text.  Conversion is in-place.
 /// @note  Multiples also work so <<<text>>> -> text. The "surrounds" are only removed if they are correctly balanced.
-inline void
-remove_surrounds(std::string& s)
-{
-    std::size_t len = s.length();
-    while (len > 1) {
-        // If the first character is alpha-numeric we are done.
-        char first = s[0];
-        if (isalnum(first)) return;
-
-        // First character is not alpha-numeric.
-        // Grab the last character & check for a match.
-        char last = s[len - 1];
-        bool match = false;
-
-        // Handle cases [text], {text}, <text>, and (text) and then all others
-        switch (first) {
-            case '(':
-                if (last == ')') match = true;
-                break;
-            case '[':
-                if (last == ']') match = true;
-                break;
-            case '{':
-                if (last == '}') match = true;
-                break;
-            case '<':
-                if (last == '>') match = true;
-                break;
-            default:
-                if (last == first) match = true;
-                break;
+template<char_string String>
+void
+remove_surrounds(String& s)
+{
+    // Find the layers of surrounds first & then shift what is left to the front just the once.
+    std::size_t b = 0, e = s.size();
+    while (e - b > 1 && is_surround(s[b], s[e - 1])) {
+        ++b;
+        --e;
+    }
+    s.resize(e);
+    s.erase(0, b);
+}
+
+/// @brief "Standardize" a string -- turns "[ hallo   world ]  " or "   Hallo World" into "HALLO WORLD"
+/// @note  This gives the same result as condensing the white space, converting to upper case, removing surrounds, &
+///        trimming in turn. However, we work out the bounds of the result first & then write it in a single pass.
+template<char_string String>
+void
+standardize(String& s)
+{
+    // Trim the string -- what is left starts & ends with non-space characters.
+    std::size_t b = 0, e = s.size();
+    while (b < e && is_space(s[b])) ++b;
+    while (e > b && is_space(s[e - 1])) --e;
+
+    // Peel off the layers of surrounds. Once condensed, a run of white space is a single space so if both ends are
+    // white space they count as one more layer.
+    while (e - b > 1) {
+        if (is_space(s[b]) && is_space(s[e - 1])) {
+            while (b < e && is_space(s[b])) ++b;
+            while (e > b && is_space(s[e - 1])) --e;
+        }
+        else if (is_surround(s[b], s[e - 1])) {
+            ++b;
+            --e;
         }
+        else {
+            break;
+        }
+    }
+    while (b < e && is_space(s[b])) ++b;
+    while (e > b && is_space(s[e - 1])) --e;
 
-        if (match) {
-            // Shrink the string and continue
-            s = s.substr(1, len - 2);
-            len -= 2;
+    // Write the condensed, upper cased, result to the front of the string.
+    std::size_t out = 0;
+    for (std::size_t i = b; i < e;) {
+        if (is_space(s[i])) {
+            while (i < e && is_space(s[i])) ++i;
+            s[out++] = ' ';
         }
         else {
-            // No match => no surround so we can exit.
-            return;
+            auto ch = s[i++];
+            s[out++] = static_cast<unsigned char>(ch - 'a') < 26 ? static_cast<char>(ch ^ 0x20) : ch;
         }
     }
+    s.resize(out);
 }
 
-/// @brief "Standardize" a string -- turns "[ hallo   world ]  " or "   Hallo World" into "HALLO WORLD"
-inline void
-standardize(std::string& s)
+// --------------------------------------------------------------------------------------------------------------------
+// Next we have versions that return a view into the input string -- these just narrow the view & never allocate.
+// The input string must outlive the view of course.
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief Returns a view of the input with leading white-space removed.
+constexpr std::string_view
+trimmed_left_view(std::string_view input)
 {
-    condense(s);
-    upper_case(s);
-    remove_surrounds(s);
-    trim(s);
+    std::size_t b = 0;
+    while (b < input.size() && is_space(input[b])) ++b;
+    return input.substr(b);
+}
+
+/// @brief Returns a view of the input with trailing white-space removed.
+constexpr std::string_view
+trimmed_right_view(std::string_view input)
+{
+    std::size_t e = input.size();
+    while (e > 0 && is_space(input[e - 1])) --e;
+    return input.substr(0, e);
+}
+
+/// @brief Returns a view of the input with all leading and trailing white-space removed.
+constexpr std::string_view
+trimmed_view(std::string_view input)
+{
+    return trimmed_right_view(trimmed_left_view(input));
+}
+
+/// @brief Returns a view of the input with any "surrounds" stripped from it e.g. (text) -> text, <<<text>>> -> text.
+/// @note  The "surrounds" are only removed if they are correctly balanced.
+inline std::string_view
+removed_surrounds_view(std::string_view input)
+{
+    while (input.size() > 1 && is_surround(input.front(), input.back())) input = input.substr(1, input.size() - 2);
+    return input;
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -205,7 +482,7 @@ standardize(std::string& s)
 // These happily work on *const* input strings as the inputs are left unaltered.
 // --------------------------------------------------------------------------------------------------------------------
 /// @brief Returns a new string that is a copy of the input converted to upper case.
-/// @note  Uses the standard C-library @c toupper(...) function (so will not work for wide character sets).
+/// @note  Only the ASCII letters are converted (see `upper_case`).
 inline std::string
 upper_cased(std::string_view input)
 {
@@ -215,7 +492,7 @@ upper_cased(std::string_view input)
 }
 
 /// @brief Returns a new string that is a copy of the input converted to lower case.
-/// @note  Uses the standard C-library @c tolower(...) function (so will not work for wide character sets).
+/// @note  Only the ASCII letters are converted (see `lower_case`).
 inline std::string
 lower_cased(std::string_view input)
 {
@@ -224,31 +501,51 @@ lower_cased(std::string_view input)
     return s;
 }
 
-/// @brief Returns a new string that is a copy of the input with leading white-space removed.
+/// @brief Returns a new string that is a copy of the input converted to upper case using the rules of a locale.
 inline std::string
-trimmed_left_(std::string_view input)
+upper_cased(std::string_view input, const std::locale& loc)
 {
     std::string s{input};
-    trim_left(s);
+    upper_case(s, loc);
     return s;
 }
 
-/// @brief Returns a new string that is a copy of the input with trailing white-space removed.
+/// @brief Returns a new string that is a copy of the input converted to lower case using the rules of a locale.
 inline std::string
-trimmed_right(std::string_view input)
+lower_cased(std::string_view input, const std::locale& loc)
 {
     std::string s{input};
-    trim_right(s);
+    lower_case(s, loc);
     return s;
 }
 
+/// @brief Returns a new string that is a copy of the input with leading white-space removed.
+/// @note  Only the characters we keep are copied (see `trimmed_left_view` if you don't need a copy at all).
+inline std::string
+trimmed_left(std::string_view input)
+{
+    return std::string{trimmed_left_view(input)};
+}
+
+/// @brief The original misspelt name for `trimmed_left` which we keep so existing code still compiles.
+inline std::string
+trimmed_left_(std::string_view input)
+{
+    return trimmed_left(input);
+}
+
+/// @brief Returns a new string that is a copy of the input with trailing white-space removed.
+inline std::string
+trimmed_right(std::string_view input)
+{
+    return std::string{trimmed_right_view(input)};
+}
+
 /// @brief Returns a new string that is a copy of the input with all leading and trailing white-space removed.
 inline std::string
 trimmed(std::string_view input)
 {
-    std::string s{input};
-    trim(s);
-    return s;
+    return std::string{trimmed_view(input)};
 }
 
 /// @brief Returns a new string that is a copy of the input with the first occurrence of a target substring replaced.
@@ -288,7 +585,7 @@ replaced(std::string_view input, std::string_view target, std::string_view repla
 /// @param with By default they are replaced with a single space character
 /// @param also_trim By default any white space at the beginning and end is removed entirely
 inline std::string
-replaced_space(std::string_view input, const std::string& with = " ", bool also_trim = true)
+replaced_space(std::string_view input, std::string_view with = " ", bool also_trim = true)
 {
     std::string s{input};
     replace_space(s, with, also_trim);
@@ -341,9 +638,7 @@ erased(std::string_view input, std::string_view target)
 inline std::string
 removed_surrounds(std::string_view input)
 {
-    std::string s{input};
-    remove_surrounds(s);
-    return s;
+    return std::string{removed_surrounds_view(input)};
 }
 
 /// @brief  Returns a "standardized" string that is a copy of the input.
@@ -356,26 +651,120 @@ standardized(std::string_view input)
     return s;
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+// The same copy functions again but with the copy allocated from a `std::pmr::memory_resource` you pass in last.
+// Give them a `std::pmr::monotonic_buffer_resource` per request or per batch & release all the copies in one go.
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief Returns a copy of the input allocated from a memory resource & converted to upper case.
+inline std::pmr::string
+upper_cased(std::string_view input, std::pmr::memory_resource* mr)
+{
+    std::pmr::string s{input, mr};
+    upper_case(s);
+    return s;
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource & converted to lower case.
+inline std::pmr::string
+lower_cased(std::string_view input, std::pmr::memory_resource* mr)
+{
+    std::pmr::string s{input, mr};
+    lower_case(s);
+    return s;
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource with leading white-space removed.
+inline std::pmr::string
+trimmed_left(std::string_view input, std::pmr::memory_resource* mr)
+{
+    return std::pmr::string{trimmed_left_view(input), mr};
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource with trailing white-space removed.
+inline std::pmr::string
+trimmed_right(std::string_view input, std::pmr::memory_resource* mr)
+{
+    return std::pmr::string{trimmed_right_view(input), mr};
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource with leading & trailing white-space removed.
+inline std::pmr::string
+trimmed(std::string_view input, std::pmr::memory_resource* mr)
+{
+    return std::pmr::string{trimmed_view(input), mr};
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource with all occurrences of a target replaced.
+inline std::pmr::string
+replaced(std::string_view input, std::string_view target, std::string_view replacement, std::pmr::memory_resource* mr)
+{
+    std::pmr::string s{input, mr};
+    replace(s, target, replacement);
+    return s;
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource with contiguous white space condensed.
+inline std::pmr::string
+condensed(std::string_view input, bool also_trim, std::pmr::memory_resource* mr)
+{
+    std::pmr::string s{input, mr};
+    condense(s, also_trim);
+    return s;
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource with contiguous white space condensed & trimmed.
+inline std::pmr::string
+condensed(std::string_view input, std::pmr::memory_resource* mr)
+{
+    return condensed(input, true, mr);
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource with all occurrences of a target erased.
+inline std::pmr::string
+erased(std::string_view input, std::string_view target, std::pmr::memory_resource* mr)
+{
+    std::pmr::string s{input, mr};
+    erase(s, target);
+    return s;
+}
+
+/// @brief Returns a copy of the input allocated from a memory resource with any "surrounds" stripped from it.
+inline std::pmr::string
+removed_surrounds(std::string_view input, std::pmr::memory_resource* mr)
+{
+    return std::pmr::string{removed_surrounds_view(input), mr};
+}
+
+/// @brief Returns a "standardized" copy of the input allocated from a memory resource.
+inline std::pmr::string
+standardized(std::string_view input, std::pmr::memory_resource* mr)
+{
+    std::pmr::string s{input, mr};
+    standardize(s);
+    return s;
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 // Next some functions that have no 'in-place' versus 'out-of-place' versions.
 // --------------------------------------------------------------------------------------------------------------------
 /// @brief Check if a string starts with a particular prefix string.
 /// @param str the string to check.
 /// @param prefix the substring to look for at the start.
-inline bool
+/// @note  Only the first `prefix.size()` characters are ever compared.
+constexpr bool
 starts_with(std::string_view str, std::string_view prefix)
 {
-    return str.find(prefix) == 0;
+    return str.starts_with(prefix);
 }
 
 /// @brief Check if a string ends with a particular suffix string.
 /// @param str the string to check.
 /// @param suffix the substring to look for at the end.
-inline bool
+/// @note  Only the last `suffix.size()` characters are ever compared.
+constexpr bool
 ends_with(std::string_view str, std::string_view suffix)
 {
-    const auto pos = str.rfind(suffix);
-    return (pos != std::string::npos) && (pos == (str.length() - suffix.length()));
+    return str.ends_with(suffix);
 }
 
 /// @brief Try to read a value of a particular type from a @c std::string.
@@ -386,7 +775,7 @@ template<typename T>
 constexpr std::optional<T>
 possible(std::string_view in, const char** next = nullptr)
 {
-    in.remove_prefix(in.find_first_not_of("+ "));
+    in.remove_prefix(std::min(in.find_first_not_of("+ "), in.size()));
     T    retval;
     auto ec = std::from_chars(in.cbegin(), in.cend(), retval);
     if (next) *next = ec.ptr;
@@ -394,6 +783,116 @@ possible(std::string_view in, const char** next = nullptr)
     return retval;
 }
 
+/// @brief A set of characters stored as a 256-bit lookup table so membership is a single test.
+/// @note  Sets that are known at compile time can be `constexpr` e.g. `constexpr char_set csv{","}`.
+/// @note  Searching for the first member of the set in some text is vectorised where we can. If every member is ASCII
+///        we classify 16 bytes at a time using the low & high nibble of each byte to index two small tables (SSSE3
+///        @c pshufb or NEON @c tbl). With plain SSE2 we compare against each member instead (up to 16 of them).
+class char_set {
+public:
+    /// @brief Construct a set from the characters in a string.
+    constexpr char_set(std::string_view chars = "")
+    {
+        for (char c : chars) insert(c);
+    }
+
+    /// @brief Adds a character to the set.
+    constexpr void insert(char c)
+    {
+        auto u = static_cast<unsigned char>(c);
+        if (contains(c)) return;
+        m_bits[u / 64] |= std::uint64_t{1} << (u % 64);
+        if (u < 0x80)
+            m_nibbles[u & 0x0F] = static_cast<std::uint8_t>(m_nibbles[u & 0x0F] | (1u << (u >> 4)));
+        else
+            m_ascii = false;
+        if (m_size < m_members.size()) m_members[m_size] = c;
+        ++m_size;
+    }
+
+    /// @brief Is a character in the set?
+    constexpr bool contains(char c) const
+    {
+        auto u = static_cast<unsigned char>(c);
+        return (m_bits[u / 64] >> (u % 64)) & 1;
+    }
+
+    /// @brief The number of distinct characters in the set.
+    constexpr std::size_t size() const { return m_size; }
+
+    /// @brief Returns the position of the first character in `text` at or after `pos` that is in the set (or `npos`).
+    constexpr std::size_t find_first_in(std::string_view text, std::size_t pos = 0) const
+    {
+        if (!std::is_constant_evaluated() && m_ascii) {
+#if defined(UTILITIES_HAVE_SSSE3)
+            const __m128i lo_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_nibbles.data()));
+            const __m128i hi_table = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m128i low_bits = _mm_set1_epi8(0x0F), zero = _mm_setzero_si128();
+            for (; pos + 16 <= text.size(); pos += 16) {
+                auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+                auto lo = _mm_shuffle_epi8(lo_table, _mm_and_si128(block, low_bits));
+                auto hi = _mm_shuffle_epi8(hi_table, _mm_and_si128(_mm_srli_epi16(block, 4), low_bits));
+                auto miss = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero)));
+                if (miss != 0xFFFF) return pos + static_cast<std::size_t>(std::countr_one(miss));
+            }
+#elif defined(UTILITIES_HAVE_SSE2)
+            if (m_size <= m_members.size()) {
+                __m128i members[16];
+                for (std::size_t k = 0; k < m_size; ++k) members[k] = _mm_set1_epi8(m_members[k]);
+                for (; pos + 16 <= text.size(); pos += 16) {
+                    auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+                    auto hits = _mm_setzero_si128();
+                    for (std::size_t k = 0; k < m_size; ++k)
+                        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, members[k]));
+                    auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+                    if (mask != 0) return pos + static_cast<std::size_t>(std::countr_zero(mask));
+                }
+            }
+#elif defined(UTILITIES_HAVE_NEON)
+            const uint8x16_t lo_table = vld1q_u8(m_nibbles.data());
+            const uint8x16_t hi_table = {1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0, 0};
+            const uint8x16_t low_bits = vdupq_n_u8(0x0F);
+            for (; pos + 16 <= text.size(); pos += 16) {
+                auto block = vld1q_u8(reinterpret_cast<const std::uint8_t*>(text.data() + pos));
+                auto lo = vqtbl1q_u8(lo_table, vandq_u8(block, low_bits));
+                auto hi = vqtbl1q_u8(hi_table, vshrq_n_u8(block, 4));
+                auto hits = vtstq_u8(lo, hi);
+
+                // Narrow each byte of the mask to a nibble so the whole mask fits in a 64-bit word.
+                auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+                if (mask != 0) return pos + static_cast<std::size_t>(std::countr_zero(mask)) / 4;
+            }
+#endif
+        }
+        for (; pos < text.size(); ++pos)
+            if (contains(text[pos])) return pos;
+        return std::string_view::npos;
+    }
+
+private:
+    std::array<std::uint64_t, 4> m_bits{};       // One bit per possible character.
+    std::array<std::uint8_t, 16> m_nibbles{};    // For ASCII members: bit h of entry l is set if (h << 4 | l) is in.
+    std::array<char, 16>         m_members{};    // The first few members (for the plain SSE2 search).
+    std::size_t                  m_size = 0;     // The number of members.
+    bool                         m_ascii = true; // Are all the members ASCII characters?
+};
+
+/// @brief Given input text and a set of delimiters, tokenize the text and pass the tokens to a function.
+/// @param function Will be called with a token like this `function(token_begin, token_end)` (string_view iterators).
+/// @note  This is the fast path for contiguous text -- the delimiters are looked up in a table & not searched for.
+template<typename BinaryFunc>
+constexpr void
+for_each_token(std::string_view input, const char_set& delimiters, BinaryFunc function)
+{
+    std::size_t b = 0;
+    while (b != input.size()) {
+        auto x = std::min(delimiters.find_first_in(input, b), input.size()); // Find a token in the input text
+        function(input.begin() + b, input.begin() + x);                     // Call the user supplied function on it
+        if (x == input.size()) break;                                        // Stop if we hit the end of the input text
+        b = x + 1;                                                           // Otherwise go again past that token
+    }
+}
+
 /// @brief Given input text and delimiters, tokenize the text and pass the tokens to a function
 /// @param b If the text is in `str` this parameter might be `cbegin(str)`
 /// @param e If the text is in `str` this parameter might be `cend(str)`
@@ -401,18 +900,43 @@ possible(std::string_view in, const char** next = nullptr)
 /// @param de If the possible delimiters are in ``delims` this might be `cend(delims)`
 /// @param function Will be called with a token like this `function(token_begin, token_end)
 /// @note Credit to [blog article](https://tristanbrindle.com/posts/a-quicker-study-on-tokenising/)
+/// @note If the text is contiguous `char`s we build a `char_set` of the delimiters & use the table-driven version.
 template<std::input_iterator InputIt, std::forward_iterator ForwardIt, typename BinaryFunc>
 constexpr void
 for_each_token(InputIt ib, InputIt ie, ForwardIt db, ForwardIt de, BinaryFunc function)
 {
-    while (ib != ie) {
-        const auto x = std::find_first_of(ib, ie, db, de); // Find a token in the input text
-        function(ib, x);                                   // Call the user supplied function on the token
-        if (x == ie) break;                                // Stop if we hit the end of the input text
-        ib = std::next(x);                                 // Otherwise go again past that token we just found
+    if constexpr (std::contiguous_iterator<InputIt> && std::is_same_v<std::iter_value_t<InputIt>, char> &&
+                  std::is_convertible_v<std::iter_value_t<ForwardIt>, char>) {
+        char_set delimiters;
+        for (auto d = db; d != de; ++d) delimiters.insert(*d);
+        std::string_view input{std::to_address(ib), static_cast<std::size_t>(ie - ib)};
+        for_each_token(input, delimiters,
+                       [&](auto tb, auto te) { function(ib + (tb - input.begin()), ib + (te - input.begin())); });
+    }
+    else {
+        while (ib != ie) {
+            const auto x = std::find_first_of(ib, ie, db, de); // Find a token in the input text
+            function(ib, x);                                   // Call the user supplied function on the token
+            if (x == ie) break;                                // Stop if we hit the end of the input text
+            ib = std::next(x);                                 // Otherwise go again past that token we just found
+        }
     }
 }
 
+/// @brief Tokenize a string and put the tokens into the passed output container.
+/// @param input The string to tokenize
+/// @param output You pass in this "STL" container which we fill with the tokens.
+/// @param delimiters The set of characters that break up the tokens.
+/// @param skip By default we ignore any empty tokens (e.g. two spaces in a row)
+template<typename Container_t>
+constexpr void
+tokenize(std::string_view input, Container_t& output, const char_set& delimiters, bool skip = true)
+{
+    for_each_token(input, delimiters, [&output, &skip](auto tb, auto te) {
+        if (tb != te || !skip) { output.emplace_back(tb, te); }
+    });
+}
+
 /// @brief Tokenize a string and put the tokens into the passed output container.
 /// @param input The string to tokenize
 /// @param output You pass in this "STL" container which we fill with the tokens.
@@ -422,14 +946,44 @@ template<typename Container_t>
 constexpr void
 tokenize(std::string_view input, Container_t& output, std::string_view delimiters = "\t,;: ", bool skip = true)
 {
-    auto ib = cbegin(input);
-    auto ie = cend(input);
-    auto db = cbegin(delimiters);
-    auto de = cend(delimiters);
+    tokenize(input, output, char_set{delimiters}, skip);
+}
 
-    for_each_token(ib, ie, db, de, [&output, &skip](auto tb, auto te) {
-        if (tb != te || !skip) { output.emplace_back(tb, te); }
+/// @brief Tokenize a string and write the tokens as `std::string_view`'s into the input to an output iterator.
+/// @param out For example, `std::back_inserter(views)` where `views` is a container of `std::string_view`'s.
+/// @return The new value of the output iterator.
+/// @note  Nothing is copied so the tokens are only valid as long as the input string is.
+template<std::output_iterator<std::string_view> OutputIt>
+constexpr OutputIt
+tokenize_to(std::string_view input, OutputIt out, const char_set& delimiters, bool skip = true)
+{
+    for_each_token(input, delimiters, [&out, &skip](auto tb, auto te) {
+        if (tb != te || !skip) *out++ = std::string_view{tb, te};
     });
+    return out;
+}
+
+/// @brief Tokenize a string and write the tokens as `std::string_view`'s into the input to an output iterator.
+/// @param delimiters By default tokens are broken on white space, commas, semi-colons, and colons.
+/// @return The new value of the output iterator.
+template<std::output_iterator<std::string_view> OutputIt>
+constexpr OutputIt
+tokenize_to(std::string_view input, OutputIt out, std::string_view delimiters = "\t,;: ", bool skip = true)
+{
+    return tokenize_to(input, out, char_set{delimiters}, skip);
+}
+
+/// @brief Tokenize a string and return the tokens as a vector of strings
+/// @param input The string to tokenize
+/// @param delimiters The set of characters that break up the tokens.
+/// @param skip By default we ignore any empty tokens (e.g. two spaces in a row)
+/// @return std::vector<std::string> This is a vector with all the tokens
+inline std::vector<std::string>
+split(std::string_view input, const char_set& delimiters, bool skip = true)
+{
+    std::vector<std::string> output;
+    tokenize(input, output, delimiters, skip);
+    return output;
 }
 
 /// @brief Tokenize a string and return the tokens as a vector of strings
@@ -440,62 +994,862 @@ tokenize(std::string_view input, Container_t& output, std::string_view delimiter
 inline std::vector<std::string>
 split(std::string_view input, std::string_view delimiters = "\t,;: ", bool skip = true)
 {
-    std::vector<std::string> output;
-    output.reserve(input.size() / 2);
+    return split(input, char_set{delimiters}, skip);
+}
+
+/// @brief Tokenize a string and return the tokens as a vector of strings all allocated from a memory resource.
+/// @param mr The vector & every token in it are allocated from here (e.g. a `std::pmr::monotonic_buffer_resource`).
+/// @note  `tokenize` fills a `std::pmr::vector<std::pmr::string>` directly too -- the tokens use its resource.
+inline std::pmr::vector<std::pmr::string>
+split(std::string_view input, const char_set& delimiters, bool skip, std::pmr::memory_resource* mr)
+{
+    std::pmr::vector<std::pmr::string> output{mr};
     tokenize(input, output, delimiters, skip);
     return output;
 }
 
-/// @brief  A version of @c regex_replace(...) where each match in turn is is run through a function you supply.
-/// @param  ib e.g. @c std::cbegin(a_string)
-/// @param  ie e.g. @c std::cend(a_string)
-/// @param  re The regular expression that defines the match we are after.
-/// @param  f A callback function that will be passed the match and should return the desired output string.
-/// @return A new string where all the matches in @c s will have been run through @c f.
-/// @link   https://stackoverflow.com/questions/57193450/c-regex-replace-one-by-one
-template<typename Iter, typename Traits, typename CharT, typename UnaryFunction>
-std::basic_string<CharT>
-regex_replace(Iter ib, Iter ie, const std::basic_regex<CharT, Traits>& re, UnaryFunction f)
+/// @brief Tokenize a string and return the tokens as a vector of strings all allocated from a memory resource.
+inline std::pmr::vector<std::pmr::string>
+split(std::string_view input, std::string_view delimiters, bool skip, std::pmr::memory_resource* mr)
+{
+    return split(input, char_set{delimiters}, skip, mr);
+}
+
+/// @brief Tokenize a string, skipping empty tokens, & return the tokens allocated from a memory resource.
+/// @note  Without this `split(line, ",", &arena)` would quietly match the heap version with the pointer as `skip`.
+inline std::pmr::vector<std::pmr::string>
+split(std::string_view input, const char_set& delimiters, std::pmr::memory_resource* mr)
+{
+    return split(input, delimiters, true, mr);
+}
+
+/// @brief Tokenize a string, skipping empty tokens, & return the tokens allocated from a memory resource.
+inline std::pmr::vector<std::pmr::string>
+split(std::string_view input, std::string_view delimiters, std::pmr::memory_resource* mr)
 {
-    std::basic_string<CharT> s;
+    return split(input, char_set{delimiters}, true, mr);
+}
+
+/// @brief Tokenize a string on the default delimiters & return the tokens allocated from a memory resource.
+inline std::pmr::vector<std::pmr::string>
+split(std::string_view input, std::pmr::memory_resource* mr)
+{
+    return split(input, std::string_view{"\t,;: "}, true, mr);
+}
+
+/// @brief A lazy forward range over the tokens in a string -- each is a `std::string_view` into the input.
+/// @note  Nothing is allocated or copied & tokens are found one at a time as you iterate. They have the same semantics
+///        as those we pass on in `for_each_token`. The input string must outlive the view & its iterators.
+/// @example `for (auto field : split_view(line, ",")) ...`
+class split_view : public std::ranges::view_interface<split_view> {
+public:
+    class iterator {
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(const split_view* view, std::size_t pos) : m_view{view} { find(pos); }
+
+        std::string_view operator*() const { return m_view->m_input.substr(m_begin, m_end - m_begin); }
 
-    using diff_t = typename std::match_results<Iter>::difference_type;
-    diff_t match_pos_old = 0;
-    auto   end_last_match = ib;
+        iterator& operator++()
+        {
+            find(m_end + 1);
+            return *this;
+        }
+        iterator operator++(int)
+        {
+            auto retval = *this;
+            ++*this;
+            return retval;
+        }
 
-    auto callback = [&](const std::match_results<Iter>& match) {
-        auto match_pos = match.position(0);
-        auto diff = match_pos - match_pos_old;
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.m_begin == rhs.m_begin; }
+        friend bool operator==(const iterator& it, std::default_sentinel_t) { return it.m_begin == npos; }
 
-        auto start_match = end_last_match;
-        std::advance(start_match, diff);
+    private:
+        static constexpr std::size_t npos = std::string_view::npos;
 
-        s.append(end_last_match, start_match);
-        s.append(f(match));
+        const split_view* m_view = nullptr;
+        std::size_t       m_begin = npos; // Start of the current token (`npos` once we are done).
+        std::size_t       m_end = npos;   // One past the end of the current token.
 
-        auto match_len = match.length(0);
-        match_pos_old = match_pos + match_len;
-        end_last_match = start_match;
-        std::advance(end_last_match, match_len);
+        // Find the first token that starts at or after `pos` (skipping empty ones if we should).
+        void find(std::size_t pos)
+        {
+            auto input = m_view->m_input;
+            while (pos < input.size()) {
+                auto x = std::min(m_view->m_delimiters.find_first_in(input, pos), input.size());
+                if (x != pos || !m_view->m_skip) {
+                    m_begin = pos;
+                    m_end = x;
+                    return;
+                }
+                pos = x + 1;
+            }
+            m_begin = m_end = npos;
+        }
     };
 
-    std::regex_iterator<Iter> begin(ib, ie, re), end;
-    std::for_each(begin, end, callback);
-    s.append(end_last_match, ie);
-    return s;
+    split_view() = default;
+
+    /// @brief A view of the tokens in `input` that are delimited by any of the characters in a set.
+    /// @param skip By default we ignore any empty tokens (e.g. two spaces in a row)
+    split_view(std::string_view input, const char_set& delimiters, bool skip = true) :
+        m_input{input}, m_delimiters{delimiters}, m_skip{skip}
+    {}
+
+    /// @brief A view of the tokens in `input` -- by default tokens are broken on white space, commas, etc.
+    /// @param skip By default we ignore any empty tokens (e.g. two spaces in a row)
+    split_view(std::string_view input, std::string_view delimiters = "\t,;: ", bool skip = true) :
+        split_view{input, char_set{delimiters}, skip}
+    {}
+
+    iterator                begin() const { return iterator{this, 0}; }
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+private:
+    std::string_view m_input;
+    char_set         m_delimiters;
+    bool             m_skip = true;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Parsing many numbers at once ...
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief Checks whether the 8 bytes starting at `p` are all decimal digits & if so puts their value in `value`.
+/// @note  This is SWAR (SIMD within a register) -- one 64-bit load & a few multiplies replace eight digit steps.
+/// @note  The arithmetic assumes a little-endian load so on big-endian machines we always return false.
+inline bool
+parse_eight_digits(const char* p, std::uint64_t& value)
+{
+    if constexpr (std::endian::native != std::endian::little) return false;
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+
+    // Every byte must be in '0'..'9' i.e. have high nibble 3 & not overflow a nibble when we add 6.
+    if ((((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) != 0x3333333333333333))
+        return false;
+
+    // Combine neighbouring digits into 2-digit, then 4-digit, then the 8-digit value.
+    v -= 0x3030303030303030;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+         (((v >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+    value = v;
+    return true;
+}
+
+/// @brief Parses a decimal integer from the front of `[p, e)` into `value` & returns a pointer just past it.
+/// @note  Long runs of digits (IDs, timestamps, & other fixed-width integer columns) go eight digits at a time.
+/// @return A null pointer if there are no digits or the value doesn't fit in a `T`.
+template<std::integral T>
+const char*
+parse_integer(const char* p, const char* e, T& value)
+{
+    bool negative = false;
+    if constexpr (std::is_signed_v<T>) {
+        if (p != e && *p == '-') {
+            negative = true;
+            ++p;
+        }
+    }
+
+    constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+    const auto*    digits = p;
+    std::uint64_t  acc = 0, eight;
+    while (e - p >= 8 && parse_eight_digits(p, eight)) {
+        if (acc > (max - eight) / 100000000) return nullptr;
+        acc = acc * 100000000 + eight;
+        p += 8;
+    }
+    for (; p != e && static_cast<unsigned char>(*p - '0') < 10; ++p) {
+        auto digit = static_cast<std::uint64_t>(*p - '0');
+        if (acc > (max - digit) / 10) return nullptr;
+        acc = acc * 10 + digit;
+    }
+    if (p == digits) return nullptr;
+
+    // Check the value fits in a `T`.
+    using unsigned_t = std::make_unsigned_t<T>;
+    auto limit = static_cast<std::uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1u : 0u);
+    if (acc > limit) return nullptr;
+    value = negative ? static_cast<T>(unsigned_t{0} - static_cast<unsigned_t>(acc)) : static_cast<T>(acc);
+    return p;
 }
 
+/// @brief What we found when parsing a whole run of numbers from some text.
+template<typename OutputIt>
+struct parse_all_result {
+    OutputIt    out;                                 // The output iterator just past the last value written.
+    std::size_t count = 0;                           // The number of values parsed.
+    std::size_t error = std::string_view::npos;      // Index of the token that failed to parse (npos if none did).
+    std::size_t pos = 0;                             // Where we stopped in the text.
+
+    /// @brief Did every token parse?
+    constexpr bool ok() const { return error == std::string_view::npos; }
+};
+
+/// @brief Parses every token in some text as a `T` & writes the values to an output iterator.
+/// @param delimiters The tokens are separated by runs of any of these characters.
+/// @note  Tokenising & parsing are fused into one pass -- each number is parsed in place & must then be followed by a
+///        delimiter or the end of the text. A single leading '+' is allowed. Integers use `parse_integer` while
+///        floating point values use @c std::from_chars(...).
+/// @note  We stop at the first token that isn't a valid `T` & report its index (and position) in the result.
+template<typename T, std::output_iterator<const T&> OutputIt>
+    requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+parse_all_result<OutputIt>
+parse_all(std::string_view text, OutputIt out, const char_set& delimiters,
+          std::size_t max_count = std::numeric_limits<std::size_t>::max())
+{
+    parse_all_result<OutputIt> retval{out};
+    const char*                end = text.data() + text.size();
+    std::size_t                pos = 0;
+    while (retval.count < max_count) {
+        while (pos < text.size() && delimiters.contains(text[pos])) ++pos;
+        if (pos == text.size()) break;
+
+        const char* b = text.data() + pos;
+        if (*b == '+' && b + 1 != end && b[1] != '-') ++b;
+        T           value;
+        const char* p;
+        if constexpr (std::is_integral_v<T>) {
+            p = parse_integer(b, end, value);
+        }
+        else {
+            auto [ptr, ec] = std::from_chars(b, end, value);
+            p = ec == std::errc{} ? ptr : nullptr;
+        }
+        if (p == nullptr || (p != end && !delimiters.contains(*p))) {
+            retval.error = retval.count;
+            break;
+        }
+        *retval.out++ = value;
+        ++retval.count;
+        pos = static_cast<std::size_t>(p - text.data());
+    }
+    retval.pos = pos;
+    return retval;
+}
+
+/// @brief Parses every token in some text as a `T` & writes the values to an output iterator.
+/// @param delimiters By default tokens are broken on white space, commas, semi-colons, and colons.
+template<typename T, std::output_iterator<const T&> OutputIt>
+    requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+parse_all_result<OutputIt>
+parse_all(std::string_view text, OutputIt out, std::string_view delimiters = "\t,;: ")
+{
+    return parse_all<T>(text, out, char_set{delimiters});
+}
+
+/// @brief Parses the tokens in some text as `T`'s into a span of values, stopping when it is full.
+/// @note  Check `count` in the result to see how many of the values were filled in. If `ok()` is true & there are more
+///        tokens to come, then `pos` is where to continue from.
+template<typename T>
+    requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+parse_all_result<T*>
+parse_all(std::string_view text, std::span<T> values, const char_set& delimiters)
+{
+    return parse_all<T>(text, values.data(), delimiters, values.size());
+}
+
+/// @brief Parses the tokens in some text as `T`'s into a span of values, stopping when it is full.
+/// @param delimiters By default tokens are broken on white space, commas, semi-colons, and colons.
+template<typename T>
+    requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+parse_all_result<T*>
+parse_all(std::string_view text, std::span<T> values, std::string_view delimiters = "\t,;: ")
+{
+    return parse_all<T>(text, values, char_set{delimiters});
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// Regular expression replacements where each match is run through a function you supply ...
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief A thread local cache of compiled regular expressions keyed by their pattern & flags.
+/// @note  Compiling a `std::regex` is expensive so code that builds one from the same pattern on every call should get
+///        it from here instead. Each thread has its own cache so there is no locking. Entries are never evicted (bar
+///        an explicit `clear()`) so the references handed out stay valid for the life of the calling thread.
+class regex_cache {
+public:
+    using flag_type = std::regex::flag_type;
+
+    /// @brief Class method that returns the compiled regex for a pattern -- compiling it on first use.
+    /// @throw `std::regex_error` if the pattern is invalid (in which case nothing is cached).
+    static const std::regex& get(std::string_view pattern, flag_type flags = std::regex::ECMAScript)
+    {
+        auto& c = cache();
+        if (auto it = c.find(key_view{pattern, flags}); it != c.end()) return it->second;
+        std::regex re{pattern.begin(), pattern.end(), flags};
+        return c.emplace(key{std::string{pattern}, flags}, std::move(re)).first->second;
+    }
+
+    /// @brief Class method that returns the number of regular expressions cached on the calling thread.
+    static std::size_t size() { return cache().size(); }
+
+    /// @brief Class method that empties the calling thread's cache -- any references it handed out become invalid.
+    static void clear() { cache().clear(); }
+
+private:
+    struct key_view {
+        std::string_view pattern;
+        flag_type        flags;
+    };
+    struct key {
+        std::string pattern;
+        flag_type   flags;
+        operator key_view() const { return {pattern, flags}; }
+    };
+    struct hasher {
+        using is_transparent = void;
+        std::size_t operator()(key_view k) const
+        {
+            return std::hash<std::string_view>{}(k.pattern) ^ (static_cast<std::size_t>(k.flags) * 0x9E3779B9u);
+        }
+    };
+    struct equal {
+        using is_transparent = void;
+        bool operator()(key_view a, key_view b) const { return a.flags == b.flags && a.pattern == b.pattern; }
+    };
+
+    static std::unordered_map<key, std::regex, hasher, equal>& cache()
+    {
+        thread_local std::unordered_map<key, std::regex, hasher, equal> retval;
+        return retval;
+    }
+};
+
 /// @brief  A version of @c regex_replace(...) where each match in turn is is run through a function you supply.
-/// @param  s The string to hunt for matches in.
+/// @param  ib e.g. @c std::cbegin(a_string)
+/// @param  ie e.g. @c std::cend(a_string)
 /// @param  re The regular expression that defines the match we are after.
+/// @param  out Where to write the result -- the text between the matches is copied & each match is replaced.
+/// @param  f A callback function that will be passed the match and should return the desired output string.
+/// @return The output iterator just past the last character written.
+template<typename Iter, typename OutputIt, typename Traits, typename CharT, typename UnaryFunction>
+OutputIt
+regex_replace_to(Iter ib, Iter ie, const std::basic_regex<CharT, Traits>& re, OutputIt out, UnaryFunction f)
+{
+    auto last = ib;
+    for (std::regex_iterator<Iter, CharT, Traits> it{ib, ie, re}, end; it != end; ++it) {
+        const auto& match = *it;
+        out = std::copy(last, match[0].first, out);
+        const auto& replacement = f(match);
+        out = std::ranges::copy(std::basic_string_view<CharT>{replacement}, out).out;
+        last = match[0].second;
+    }
+    return std::copy(last, ie, out);
+}
+
+/// @brief  A version of @c regex_replace_to(...) for any other regular expression engine you care to plug in.
+/// @note   An `engine` has a `for_each_match(ib, ie, on_match)` method that calls `on_match(mb, me, match)` for each of
+///         the non-overlapping matches in `[ib, ie)` from left to right. Here `[mb, me)` is the matched text & `match`
+///         is whatever the engine wants to pass on to the callback `f` (which returns the replacement as before).
+/// @note   This lets you put a faster engine (RE2, PCRE, CTRE, ...) behind the same callback driven interface.
+template<typename Iter, typename OutputIt, typename Engine, typename UnaryFunction>
+OutputIt
+regex_replace_to(Iter ib, Iter ie, const Engine& engine, OutputIt out, UnaryFunction f)
+{
+    using char_type = std::iter_value_t<Iter>;
+    auto last = ib;
+    engine.for_each_match(ib, ie, [&](Iter mb, Iter me, const auto& match) {
+        out = std::copy(last, mb, out);
+        const auto& replacement = f(match);
+        out = std::ranges::copy(std::basic_string_view<char_type>{replacement}, out).out;
+        last = me;
+    });
+    return std::copy(last, ie, out);
+}
+
+/// @brief  A version of @c regex_replace(...) where each match in turn is is run through a function you supply.
+/// @param  ib e.g. @c std::cbegin(a_string)
+/// @param  ie e.g. @c std::cend(a_string)
+/// @param  re The regular expression that defines the match we are after (or any engine `regex_replace_to` accepts).
 /// @param  f A callback function that will be passed the match and should return the desired output string.
 /// @return A new string where all the matches in @c s will have been run through @c f.
 /// @link   https://stackoverflow.com/questions/57193450/c-regex-replace-one-by-one
-template<typename Traits, typename CharT, typename UnaryFunction>
+template<typename Iter, typename Regex, typename UnaryFunction>
+std::basic_string<std::iter_value_t<Iter>>
+regex_replace(Iter ib, Iter ie, const Regex& re, UnaryFunction f)
+{
+    // Most rewrites are of similar length to the input so reserving that much saves most of the regrowth.
+    std::basic_string<std::iter_value_t<Iter>> retval;
+    retval.reserve(static_cast<std::size_t>(std::distance(ib, ie)));
+    regex_replace_to(ib, ie, re, std::back_inserter(retval), f);
+    return retval;
+}
+
+/// @brief  A version of @c regex_replace(...) where each match in turn is is run through a function you supply.
+/// @param  s The string to hunt for matches in.
+/// @param  re The regular expression that defines the match we are after (or any engine `regex_replace_to` accepts).
+/// @param  f A callback function that will be passed the match and should return the desired output string.
+/// @return A new string where all the matches in @c s will have been run through @c f.
+/// @link   https://stackoverflow.com/questions/57193450/c-regex-replace-one-by-one
+template<typename Regex, typename UnaryFunction>
+    requires(!std::is_convertible_v<const Regex&, std::string_view>)
 std::string
-regex_replace(const std::string& s, const std::basic_regex<CharT, Traits>& re, UnaryFunction f)
+regex_replace(const std::string& s, const Regex& re, UnaryFunction f)
 {
     return regex_replace(s.cbegin(), s.cend(), re, f);
 }
 
+/// @brief  A version of @c regex_replace(...) that looks up the compiled regex for a pattern in the `regex_cache`.
+/// @param  s The string to hunt for matches in.
+/// @param  pattern The pattern for the regular expression that defines the match we are after.
+/// @param  f A callback function that will be passed the match (a `std::smatch`) and should return the output string.
+/// @param  flags The flags used to compile the pattern.
+template<typename UnaryFunction>
+std::string
+regex_replace(const std::string& s, std::string_view pattern, UnaryFunction f,
+              std::regex::flag_type flags = std::regex::ECMAScript)
+{
+    return regex_replace(s.cbegin(), s.cend(), regex_cache::get(pattern, flags), f);
+}
+
+/// @brief  A version of @c regex_replace_to(...) that looks up the compiled regex for a pattern in the `regex_cache`.
+template<typename OutputIt, typename UnaryFunction>
+OutputIt
+regex_replace_to(const std::string& s, std::string_view pattern, OutputIt out, UnaryFunction f,
+                 std::regex::flag_type flags = std::regex::ECMAScript)
+{
+    return regex_replace_to(s.cbegin(), s.cend(), regex_cache::get(pattern, flags), out, f);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// A compiled multi-pattern replacer ...
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief Replaces occurrences of any number of targets in a single pass over a string.
+/// @note  The targets are compiled into an Aho-Corasick automaton once & the replacer can then be reused on as many
+///        strings as you like. Scanning from left to right, at each point we replace the target that starts earliest,
+///        picking the longest one if several start at the same place. Replacements are never rescanned.
+/// @note  Empty targets are ignored & if a target appears more than once the first replacement given for it is used.
+class multi_replacer {
+public:
+    /// @brief Compile a list of target & replacement pairs e.g. `multi_replacer r{{"{name}", "Joan"}, {"{age}", "42"}}`
+    multi_replacer(std::initializer_list<std::pair<std::string_view, std::string_view>> pairs) :
+        multi_replacer{std::ranges::subrange{pairs.begin(), pairs.end()}}
+    {}
+
+    /// @brief Compile any range of target & replacement pairs (e.g. a `std::map<std::string, std::string>`).
+    template<std::ranges::input_range Pairs>
+    explicit multi_replacer(const Pairs& pairs)
+    {
+        m_next.assign(c_alphabet, -1);
+        m_depth.push_back(0);
+        m_target.push_back(-1);
+        for (const auto& [target, replacement] : pairs) add(target, replacement);
+        compile();
+    }
+
+    /// @brief The number of (distinct, non-empty) targets.
+    std::size_t size() const { return m_targets.size(); }
+
+    /// @brief Calls `f(piece)` with the successive pieces of the output (as `std::string_view`'s) for some input.
+    template<typename Func>
+    void for_each_piece(std::string_view input, Func f) const
+    {
+        // The automaton finds matches where they end but we pick them by where they start. So we note the longest
+        // match starting at each of the last few positions in a ring & only settle a position once no target that is
+        // still being read could start at or before it. Each character is read just once.
+        const auto                mask = std::bit_ceil(m_longest + 1) - 1;
+        std::vector<std::int32_t> found(mask + 1, -1);
+        std::size_t               emitted = 0, settled = 0, state = 0;
+
+        auto settle = [&](std::size_t limit) {
+            for (; settled < limit; ++settled) {
+                auto k = std::exchange(found[settled & mask], -1);
+                if (k < 0 || settled < emitted) continue;
+                auto match = static_cast<std::size_t>(k);
+                if (settled > emitted) f(input.substr(emitted, settled - emitted));
+                if (!m_replacements[match].empty()) f(std::string_view{m_replacements[match]});
+                emitted = settled + m_targets[match].size();
+            }
+        };
+
+        for (std::size_t i = 0; i < input.size();) {
+            state = static_cast<std::size_t>(m_next[state * c_alphabet + static_cast<unsigned char>(input[i])]);
+            ++i;
+
+            // Every target that ends here -- later finds for the same start are longer so they win.
+            for (auto t = m_output[state]; t >= 0; t = m_dict[static_cast<std::size_t>(t)]) {
+                auto len = m_depth[static_cast<std::size_t>(t)];
+                if (i - len >= emitted) found[(i - len) & mask] = m_target[static_cast<std::size_t>(t)];
+            }
+            settle(i - m_depth[state]);
+        }
+        settle(input.size());
+        if (emitted < input.size()) f(input.substr(emitted));
+    }
+
+    /// @brief Writes a copy of the input with all the replacements made to an output iterator & returns its new value.
+    template<std::output_iterator<char> OutputIt>
+    OutputIt replace_to(std::string_view input, OutputIt out) const
+    {
+        for_each_piece(input, [&](std::string_view piece) { out = std::copy(piece.begin(), piece.end(), out); });
+        return out;
+    }
+
+    /// @brief Returns a new string that is a copy of the input with all the replacements made.
+    std::string replaced(std::string_view input) const
+    {
+        std::string retval;
+        retval.reserve(input.size());
+        for_each_piece(input, [&retval](std::string_view piece) { retval += piece; });
+        return retval;
+    }
+
+    /// @brief Makes all the replacements in a string in-place.
+    void replace(std::string& str) const { str = replaced(str); }
+
+private:
+    static constexpr std::size_t c_alphabet = 256;
+
+    std::vector<std::string>  m_targets;      // The targets.
+    std::vector<std::string>  m_replacements; // The matching replacements.
+    std::vector<std::int32_t> m_next;         // The automaton's transitions -- `c_alphabet` of these per state.
+    std::vector<std::size_t>  m_depth;        // The length of the prefix of some target each state represents.
+    std::vector<std::int32_t> m_target;       // The index of the target each state spells out in full (or -1).
+    std::vector<std::int32_t> m_output;       // The longest state on each state's failure chain with a target (or -1).
+    std::vector<std::int32_t> m_dict;         // The next shorter state with a target on the failure chain (or -1).
+    std::size_t               m_longest = 0;  // The length of the longest target.
+
+    // Adds a target to the trie.
+    void add(std::string_view target, std::string_view replacement)
+    {
+        if (target.empty()) return;
+        std::size_t state = 0;
+        for (char c : target) {
+            auto& next = m_next[state * c_alphabet + static_cast<unsigned char>(c)];
+            if (next < 0) {
+                next = static_cast<std::int32_t>(m_depth.size());
+                m_next.resize(m_next.size() + c_alphabet, -1);
+                m_depth.push_back(m_depth[state] + 1);
+                m_target.push_back(-1);
+            }
+            state = static_cast<std::size_t>(m_next[state * c_alphabet + static_cast<unsigned char>(c)]);
+        }
+        if (m_target[state] >= 0) return;
+        m_target[state] = static_cast<std::int32_t>(m_targets.size());
+        m_longest = std::max(m_longest, target.size());
+        m_targets.emplace_back(target);
+        m_replacements.emplace_back(replacement);
+    }
+
+    // Turns the trie into a full automaton by following the failure links breadth first.
+    void compile()
+    {
+        std::vector<std::size_t> fail(m_depth.size(), 0);
+        std::vector<std::size_t> queue{0};
+        m_output.assign(m_depth.size(), -1);
+        m_dict.assign(m_depth.size(), -1);
+        for (std::size_t q = 0; q < queue.size(); ++q) {
+            auto u = queue[q];
+            for (std::size_t c = 0; c < c_alphabet; ++c) {
+                auto& next = m_next[u * c_alphabet + c];
+                auto  fallback = u == 0 ? 0 : m_next[fail[u] * c_alphabet + c];
+                if (next < 0) {
+                    next = fallback;
+                    continue;
+                }
+                auto v = static_cast<std::size_t>(next);
+                fail[v] = static_cast<std::size_t>(fallback);
+                m_dict[v] = m_output[fail[v]];
+                m_output[v] = m_target[v] >= 0 ? static_cast<std::int32_t>(v) : m_dict[v];
+                queue.push_back(v);
+            }
+        }
+    }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Batch transforms that work through lots of strings at once on several threads ...
+// --------------------------------------------------------------------------------------------------------------------
+/// @brief Lots of strings stored back to back in one contiguous block of characters along with a table of offsets.
+/// @note  Compared to a `std::vector<std::string>` all the characters are in a single allocation & walking through the
+///        strings walks straight through memory. Element `i` is a view of the characters in `[offset(i), offset(i+1))`.
+class string_batch {
+public:
+    /// @brief A random access iterator over the strings in the batch (which it hands out as views).
+    class iterator {
+    public:
+        using iterator_concept = std::random_access_iterator_tag;
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::string_view;
+
+        iterator() = default;
+        iterator(const string_batch* batch, std::size_t i) : m_batch{batch}, m_i{i} {}
+
+        std::string_view operator*() const { return (*m_batch)[m_i]; }
+        std::string_view operator[](difference_type n) const { return *(*this + n); }
+
+        iterator& operator++()
+        {
+            ++m_i;
+            return *this;
+        }
+        iterator& operator--()
+        {
+            --m_i;
+            return *this;
+        }
+        iterator operator++(int) { return {m_batch, m_i++}; }
+        iterator operator--(int) { return {m_batch, m_i--}; }
+
+        iterator& operator+=(difference_type n)
+        {
+            m_i = static_cast<std::size_t>(static_cast<difference_type>(m_i) + n);
+            return *this;
+        }
+        iterator& operator-=(difference_type n) { return *this += -n; }
+
+        friend iterator operator+(iterator it, difference_type n) { return it += n; }
+        friend iterator operator+(difference_type n, iterator it) { return it += n; }
+        friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const iterator& lhs, const iterator& rhs)
+        {
+            return static_cast<difference_type>(lhs.m_i) - static_cast<difference_type>(rhs.m_i);
+        }
+
+        friend bool operator==(const iterator& lhs, const iterator& rhs) { return lhs.m_i == rhs.m_i; }
+        friend auto operator<=>(const iterator& lhs, const iterator& rhs) { return lhs.m_i <=> rhs.m_i; }
+
+    private:
+        const string_batch* m_batch = nullptr;
+        std::size_t         m_i = 0;
+    };
+
+    string_batch() = default;
+
+    /// @brief Copies a range of strings (anything that converts to a `std::string_view`) into a batch.
+    template<std::ranges::input_range Range>
+        requires std::is_convertible_v<std::ranges::range_reference_t<const Range&>, std::string_view>
+    explicit string_batch(const Range& strings)
+    {
+        for (std::string_view str : strings) push_back(str);
+    }
+
+    /// @brief Makes room for a number of strings with a total number of characters.
+    void reserve(std::size_t strings, std::size_t chars)
+    {
+        m_offsets.reserve(strings + 1);
+        m_chars.reserve(chars);
+    }
+
+    /// @brief Appends a copy of a string to the batch.
+    void push_back(std::string_view str)
+    {
+        m_chars.append(str);
+        m_offsets.push_back(m_chars.size());
+    }
+
+    /// @brief Appends copies of all the strings in another batch.
+    void append(const string_batch& other)
+    {
+        auto base = m_chars.size();
+        m_chars.append(other.m_chars);
+        for (std::size_t i = 1; i < other.m_offsets.size(); ++i) m_offsets.push_back(base + other.m_offsets[i]);
+    }
+
+    /// @brief Forgets all the strings (but holds on to the memory).
+    void clear()
+    {
+        m_chars.clear();
+        m_offsets.resize(1);
+    }
+
+    /// @brief The number of strings in the batch.
+    std::size_t size() const { return m_offsets.size() - 1; }
+
+    /// @brief Check whether the batch is empty.
+    bool empty() const { return size() == 0; }
+
+    /// @brief Returns a view of string `i` in the batch.
+    std::string_view operator[](std::size_t i) const
+    {
+        return {m_chars.data() + m_offsets[i], m_offsets[i + 1] - m_offsets[i]};
+    }
+
+    /// @brief Read-only access to all the characters of all the strings back to back.
+    std::string_view chars() const { return m_chars; }
+
+    /// @brief Read-only access to the offset table -- string `i` starts at `offsets()[i]` & ends at `offsets()[i+1]`.
+    const std::vector<std::size_t>& offsets() const { return m_offsets; }
+
+    iterator begin() const { return {this, 0}; }
+    iterator end() const { return {this, size()}; }
+
+    /// @brief Returns copies of the strings as separate `std::string`s.
+    std::vector<std::string> to_vector() const { return {begin(), end()}; }
+
+private:
+    std::string              m_chars;         // All the characters of all the strings.
+    std::vector<std::size_t> m_offsets = {0}; // Where each string starts & one more for the end.
+};
+
+/// @brief Returns the number of blocks to split `n` strings into given a requested number of threads.
+/// @note  The default 0 means one thread per core. Small batches aren't split up at all as it isn't worth it.
+inline std::size_t
+batch_blocks(std::size_t n, std::size_t threads = 0)
+{
+    constexpr std::size_t min_block = 1024;
+    if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+    return std::clamp<std::size_t>(n / min_block, 1, threads);
+}
+
+/// @brief Splits the indices `[0, n)` into some contiguous blocks & calls `f(k, begin, end)` for each one.
+/// @note  Each block gets its own thread (bar the first which is done on the calling thread). Any exception thrown by
+///        `f` is rethrown here once all the blocks are done.
+template<typename F>
+void
+for_each_batch_block(std::size_t n, std::size_t blocks, F f)
+{
+    auto bounds = [&](std::size_t k) { return k * n / blocks; };
+    if (blocks <= 1) {
+        f(std::size_t{0}, std::size_t{0}, n);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(blocks);
+    auto                            work = [&](std::size_t k) {
+        try {
+            f(k, bounds(k), bounds(k + 1));
+        }
+        catch (...) {
+            errors[k] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t k = 1; k < blocks; ++k) workers.emplace_back(work, k);
+    work(0);
+    for (auto& worker : workers) worker.join();
+    for (auto& error : errors)
+        if (error) std::rethrow_exception(error);
+}
+
+/// @brief Calls `f(str)` on every string in a random access range of strings in-place using several threads.
+/// @param threads The number of threads to use -- the default 0 means one per core (small batches just use one).
+template<std::ranges::random_access_range Range, typename F>
+    requires std::ranges::sized_range<Range> && std::is_invocable_v<F&, std::ranges::range_reference_t<Range>>
+void
+transform_all(Range&& strings, F f, std::size_t threads = 0)
+{
+    auto first = std::ranges::begin(strings);
+    auto n = static_cast<std::size_t>(std::ranges::size(strings));
+    for_each_batch_block(n, batch_blocks(n, threads), [&](std::size_t, std::size_t b, std::size_t e) {
+        for (auto i = b; i < e; ++i) std::invoke(f, first[static_cast<std::ptrdiff_t>(i)]);
+    });
+}
+
+/// @brief Copies every string in a random access range, runs `f(copy)` on the copy in-place, & returns the results
+///        in a `string_batch` -- all on several threads.
+/// @note  The strings can be anything that converts to a `std::string_view` (including the views in a `string_batch`).
+///        Each thread works through its own block of strings with a single scratch string & appends the results to its
+///        own batch. Those are then joined together so there are just a handful of allocations in all.
+template<std::ranges::random_access_range Range, typename F>
+    requires std::ranges::sized_range<const Range&> &&
+             std::is_convertible_v<std::ranges::range_reference_t<const Range&>, std::string_view> &&
+             std::is_invocable_v<F&, std::string&>
+string_batch
+transformed_all(const Range& strings, F f, std::size_t threads = 0)
+{
+    auto first = std::ranges::begin(strings);
+    auto n = static_cast<std::size_t>(std::ranges::size(strings));
+    auto blocks = batch_blocks(n, threads);
+
+    std::vector<string_batch> results(blocks);
+    for_each_batch_block(n, blocks, [&](std::size_t k, std::size_t b, std::size_t e) {
+        std::size_t chars = 0;
+        for (auto i = b; i < e; ++i) chars += std::string_view{first[static_cast<std::ptrdiff_t>(i)]}.size();
+        auto& result = results[k];
+        result.reserve(e - b, chars);
+        std::string scratch;
+        for (auto i = b; i < e; ++i) {
+            scratch.assign(std::string_view{first[static_cast<std::ptrdiff_t>(i)]});
+            std::invoke(f, scratch);
+            result.push_back(scratch);
+        }
+    });
+    if (blocks == 1) return std::move(results[0]);
+
+    std::size_t chars = 0;
+    for (const auto& result : results) chars += result.chars().size();
+    string_batch retval;
+    retval.reserve(n, chars);
+    for (const auto& result : results) retval.append(result);
+    return retval;
+}
+
+/// @brief Standardizes every string in a range of strings in-place using several threads (see `standardize`).
+template<std::ranges::random_access_range Range>
+    requires std::ranges::sized_range<Range>
+void
+standardize_all(Range&& strings, std::size_t threads = 0)
+{
+    transform_all(strings, [](std::string& s) { standardize(s); }, threads);
+}
+
+/// @brief Condenses every string in a range of strings in-place using several threads (see `condense`).
+template<std::ranges::random_access_range Range>
+    requires std::ranges::sized_range<Range>
+void
+condense_all(Range&& strings, bool also_trim = true, std::size_t threads = 0)
+{
+    transform_all(strings, [also_trim](std::string& s) { condense(s, also_trim); }, threads);
+}
+
+/// @brief Converts every string in a range of strings to upper case in-place using several threads.
+template<std::ranges::random_access_range Range>
+    requires std::ranges::sized_range<Range>
+void
+upper_case_all(Range&& strings, std::size_t threads = 0)
+{
+    transform_all(strings, [](std::string& s) { upper_case(s); }, threads);
+}
+
+/// @brief Converts every string in a range of strings to lower case in-place using several threads.
+template<std::ranges::random_access_range Range>
+    requires std::ranges::sized_range<Range>
+void
+lower_case_all(Range&& strings, std::size_t threads = 0)
+{
+    transform_all(strings, [](std::string& s) { lower_case(s); }, threads);
+}
+
+/// @brief Returns standardized copies of a range of strings in a single `string_batch` using several threads.
+template<std::ranges::random_access_range Range>
+string_batch
+standardized_all(const Range& strings, std::size_t threads = 0)
+{
+    return transformed_all(strings, [](std::string& s) { standardize(s); }, threads);
+}
+
+/// @brief Returns condensed copies of a range of strings in a single `string_batch` using several threads.
+template<std::ranges::random_access_range Range>
+string_batch
+condensed_all(const Range& strings, bool also_trim = true, std::size_t threads = 0)
+{
+    return transformed_all(strings, [also_trim](std::string& s) { condense(s, also_trim); }, threads);
+}
+
+/// @brief Returns upper case copies of a range of strings in a single `string_batch` using several threads.
+template<std::ranges::random_access_range Range>
+string_batch
+upper_cased_all(const Range& strings, std::size_t threads = 0)
+{
+    return transformed_all(strings, [](std::string& s) { upper_case(s); }, threads);
+}
+
+/// @brief Returns lower case copies of a range of strings in a single `string_batch` using several threads.
+template<std::ranges::random_access_range Range>
+string_batch
+lower_cased_all(const Range& strings, std::size_t threads = 0)
+{
+    return transformed_all(strings, [](std::string& s) { lower_case(s); }, threads);
+}
+
 } // namespace utilities
@@ -4,9 +4,18 @@
 /// SPDX-License-Identifier: MIT
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstring>
+#include <format>
 #include <iostream>
 #include <locale>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
 
 namespace utilities {
 
@@ -55,4 +64,191 @@ pretty_print_thousands(bool on = true)
     imbue_stream_with_commas(std::clog, on);
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+// A locale free alternative ...
+// --------------------------------------------------------------------------------------------------------------------
+
+/// @brief Puts separators between the groups of three digits in the integer part of a number written in [first, end).
+/// @param last The end of the buffer which must have room for the separators after `end`.
+/// @param sep The separator to put between groups of digits.
+/// @param point If the number has a decimal point we change it to this.
+/// @return The usual `std::to_chars_result` -- on failure `ptr == last` & `ec == std::errc::value_too_large`.
+/// @note  Any sign is left alone as are the fraction & exponent. Things like "inf" and "nan" are not touched.
+inline std::to_chars_result
+insert_thousands_separators(char* first, char* end, char* last, char sep = ',', char point = '.')
+{
+    auto b = first < end && *first == '-' ? first + 1 : first;
+    auto e = b;
+    while (e < end && *e >= '0' && *e <= '9') ++e;
+    if (point != '.' && e < end && *e == '.') *e = point;
+
+    auto n = e - b;
+    auto count = n > 0 ? (n - 1) / 3 : 0;
+    if (count > last - end) return {last, std::errc::value_too_large};
+
+    // Shift the tail up & then work backwards through the digits putting in a separator after every third one.
+    std::memmove(e + count, e, static_cast<std::size_t>(end - e));
+    auto src = e, dst = e + count;
+    for (auto k = count; k > 0; --k) {
+        for (int i = 0; i < 3; ++i) *--dst = *--src;
+        *--dst = sep;
+    }
+    return {end + count, std::errc{}};
+}
+
+/// @brief Writes an integer to [first, last) with a separator between each group of three digits e.g. 1,234,567.
+/// @return The usual `std::to_chars_result` -- on failure `ptr == last` & `ec == std::errc::value_too_large`.
+/// @note  Unlike the `imbue_xxx` functions above this has no effect on anything else -- there is no locale involved.
+template<std::integral T>
+    requires(!std::is_same_v<T, bool>)
+std::to_chars_result
+to_chars_grouped(char* first, char* last, T value, char sep = ',')
+{
+    auto [end, ec] = std::to_chars(first, last, value);
+    if (ec != std::errc{}) return {end, ec};
+    return insert_thousands_separators(first, end, last, sep);
+}
+
+/// @brief Writes a floating point value to [first, last) with a separator between each group of three digits.
+/// @note  This uses the shortest representation that round trips just like `std::to_chars(first, last, value)`.
+/// @return The usual `std::to_chars_result` -- on failure `ptr == last` & `ec == std::errc::value_too_large`.
+template<std::floating_point T>
+std::to_chars_result
+to_chars_grouped(char* first, char* last, T value, char sep = ',', char point = '.')
+{
+    auto [end, ec] = std::to_chars(first, last, value);
+    if (ec != std::errc{}) return {end, ec};
+    return insert_thousands_separators(first, end, last, sep, point);
+}
+
+/// @brief Writes a floating point value to [first, last) with a separator between each group of three digits.
+/// @param fmt, precision These are passed to `std::to_chars` -- a negative precision gives the shortest round trip.
+/// @param sep The separator to put between groups of digits.
+/// @param point The decimal point to use.
+/// @return The usual `std::to_chars_result` -- on failure `ptr == last` & `ec == std::errc::value_too_large`.
+template<std::floating_point T>
+std::to_chars_result
+to_chars_grouped(char* first, char* last, T value, std::chars_format fmt, int precision = -1, char sep = ',',
+                 char point = '.')
+{
+    auto [end, ec] = precision < 0 ? std::to_chars(first, last, value, fmt) :
+                                     std::to_chars(first, last, value, fmt, precision);
+    if (ec != std::errc{}) return {end, ec};
+    return insert_thousands_separators(first, end, last, sep, point);
+}
+
+/// @brief A wrapper for a number that `std::format` prints with separators between the groups of digits.
+/// @note  Create these with `grouped(x)` so `std::format("{:>15.2f}", grouped(x))` gives something like "  12,345,678.90".
+///        The usual fill, align, sign, width, precision, & type (d, f, e, g) options all work. You can also put a
+///        separator character in the format spec after the width, so `{:_}` gives "12_345_678" whatever the default.
+template<typename T>
+    requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+struct grouped_number {
+    T    value;       // The number to print.
+    char sep = ',';   // The separator between groups of digits.
+    char point = '.'; // The decimal point.
+};
+
+/// @brief Wraps a number so that it gets printed with separators between the groups of digits e.g. 23,456.7
+/// @note  The separators are put in directly as the number is printed -- no locale is involved & nothing global changes.
+template<typename T>
+    requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+constexpr grouped_number<T>
+grouped(T value, char sep = ',', char point = '.')
+{
+    return {value, sep, point};
+}
+
 } // namespace utilities
+
+/// @brief Connect `utilities::grouped_number` to `std::format`.
+/// @note  The format spec is `[[fill]align][sign][width][sep][.precision][type]` where `sep` is one of `,_'`.
+template<typename T>
+struct std::formatter<utilities::grouped_number<T>> {
+    constexpr auto parse(std::format_parse_context& ctx)
+    {
+        auto it = ctx.begin(), end = ctx.end();
+        auto is_align = [](char c) { return c == '<' || c == '>' || c == '^'; };
+        if (it != end && it + 1 != end && is_align(it[1])) {
+            m_fill = *it;
+            m_align = it[1];
+            it += 2;
+        }
+        else if (it != end && is_align(*it)) {
+            m_align = *it++;
+        }
+        if (it != end && (*it == '+' || *it == '-' || *it == ' ')) m_sign = *it++;
+        while (it != end && *it >= '0' && *it <= '9') m_width = 10 * m_width + static_cast<std::size_t>(*it++ - '0');
+        if (it != end && (*it == ',' || *it == '_' || *it == '\'')) m_sep = *it++;
+        if (it != end && *it == '.') {
+            m_precision = 0;
+            for (++it; it != end && *it >= '0' && *it <= '9'; ++it) m_precision = 10 * m_precision + (*it - '0');
+        }
+        if (it != end && *it != '}') {
+            m_type = *it++;
+            if (std::is_integral_v<T> ? m_type != 'd' : (m_type != 'f' && m_type != 'e' && m_type != 'g'))
+                throw std::format_error("Invalid type in the format spec for a grouped number");
+        }
+        if (std::is_integral_v<T> && m_precision >= 0)
+            throw std::format_error("Precision is not allowed in the format spec for a grouped integer");
+        if (it != end && *it != '}') throw std::format_error("Invalid format spec for a grouped number");
+        return it;
+    }
+
+    template<class FormatContext>
+    auto format(const utilities::grouped_number<T>& rhs, FormatContext& ctx) const
+    {
+        auto sep = m_sep != 0 ? m_sep : rhs.sep;
+
+        // Almost every number fits in the small buffer but fixed format can produce hundreds of digits.
+        std::array<char, 128> small;
+        std::string           big;
+        auto                  text = write(small.data(), small.data() + small.size(), rhs, sep);
+        for (auto n = small.size(); text.empty();) {
+            big.resize(n *= 4);
+            text = write(big.data(), big.data() + big.size(), rhs, sep);
+        }
+
+        // Any explicit sign goes first & then we pad out to the width -- numbers are right aligned by default.
+        std::string_view sign = m_sign == '+' ? "+" : m_sign == ' ' ? " " : "";
+        if (!text.empty() && text.front() == '-') sign = {};
+        auto size = sign.size() + text.size();
+        auto pad = m_width > size ? m_width - size : 0;
+        auto left = m_align == '<' ? 0 : m_align == '^' ? pad / 2 : pad;
+
+        auto out = ctx.out();
+        out = std::fill_n(out, left, m_fill);
+        out = std::copy(sign.begin(), sign.end(), out);
+        out = std::copy(text.begin(), text.end(), out);
+        return std::fill_n(out, pad - left, m_fill);
+    }
+
+private:
+    char        m_fill = ' ';
+    char        m_align = 0;
+    char        m_sign = 0;
+    char        m_sep = 0;
+    char        m_type = 0;
+    std::size_t m_width = 0;
+    int         m_precision = -1;
+
+    // Write the grouped number into a buffer returning an empty view if there isn't enough room.
+    std::string_view write(char* first, char* last, const utilities::grouped_number<T>& rhs, char sep) const
+    {
+        std::to_chars_result r;
+        if constexpr (std::is_integral_v<T>) {
+            r = utilities::to_chars_grouped(first, last, rhs.value, sep);
+        }
+        else if (m_type == 0 && m_precision < 0) {
+            r = utilities::to_chars_grouped(first, last, rhs.value, sep, rhs.point);
+        }
+        else {
+            auto fmt = m_type == 'f' ? std::chars_format::fixed :
+                       m_type == 'e' ? std::chars_format::scientific :
+                                       std::chars_format::general;
+            auto precision = m_precision < 0 ? 6 : m_precision;
+            r = utilities::to_chars_grouped(first, last, rhs.value, fmt, precision, sep, rhs.point);
+        }
+        return r.ec == std::errc{} ? std::string_view{first, r.ptr} : std::string_view{};
+    }
+};
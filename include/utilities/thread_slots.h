@@ -0,0 +1,86 @@
+/// @brief A registry of per-thread slot sets that some other thread can merge -- the core of profile.h & metrics.h.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace utilities {
+
+/// @brief Gives each thread its own `Slots` & keeps track of them all so another thread can merge their values.
+/// @note  A thread's `Slots` is created on its first call to `local()` & when the thread exits its values are handed
+///        to `slots.retire_into(retired)` so that later merges still include them. The `Slots` class can keep its
+///        constructor private if it befriends this class.
+template<typename Slots, typename Retired>
+class thread_slots {
+public:
+    /// @brief Class method that returns the slots for the calling thread.
+    static Slots& local()
+    {
+        thread_local owner retval;
+        return retval.slots;
+    }
+
+    /// @brief Class method that calls `f(retired, live)` under the registry's lock & returns whatever that returns.
+    /// @note  `retired` holds the values from threads that have exited & `live` holds pointers to the slots of all the
+    ///        running threads. No slots are created or retired while `f` runs.
+    template<typename Func>
+    static decltype(auto) visit(Func f)
+    {
+        std::scoped_lock lock{mutex()};
+        return f(retired(), std::as_const(live()));
+    }
+
+    /// @brief Class method that constructs the shared state now so anything created later is destroyed before it.
+    static void initialize()
+    {
+        std::scoped_lock lock{mutex()};
+        live();
+        retired();
+    }
+
+private:
+    // Registers a thread's slots on creation & retires them on exit.
+    struct owner {
+        Slots slots;
+
+        owner()
+        {
+            std::scoped_lock lock{mutex()};
+            live().push_back(&slots);
+        }
+
+        ~owner()
+        {
+            std::scoped_lock lock{mutex()};
+            slots.retire_into(retired());
+            std::erase(live(), &slots);
+        }
+
+        owner(const owner&) = delete;
+        owner& operator=(const owner&) = delete;
+    };
+
+    static std::vector<Slots*>& live()
+    {
+        static std::vector<Slots*> retval;
+        return retval;
+    }
+
+    static Retired& retired()
+    {
+        static Retired retval;
+        return retval;
+    }
+
+    static std::mutex& mutex()
+    {
+        static std::mutex retval;
+        return retval;
+    }
+};
+
+} // namespace utilities
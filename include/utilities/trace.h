@@ -0,0 +1,265 @@
+/// @brief Record begin/end events for scopes across all threads & write them out as a Chrome trace timeline.
+/// @link  https://nessan.github.io/utilities/
+/// SPDX-FileCopyrightText:  2024 Nessan Fitzmaurice <nessan.fitzmaurice@me.com>
+/// SPDX-License-Identifier: MIT
+#pragma once
+
+#include "format.h"
+#include "log.h"
+#include "macros.h"
+#include "stopwatch.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// @brief Record the time from here to the end of the enclosing scope as a span called `name` on the trace timeline.
+/// @note  The name must have static storage duration (typically it is a string literal). Nothing is recorded unless
+///        `utilities::tracer::start()` has been called. Setting the `NO_TRACE` flag at compile time removes the spans.
+#ifndef NO_TRACE
+    #define TRACE_SCOPE(name)                                                                                          \
+        static const utilities::trace_site CONCAT(utilities_trace_site_, __LINE__){                                    \
+            name, __func__, utilities::message::basename(__FILE__), __LINE__};                                         \
+        const utilities::trace_guard CONCAT(utilities_trace_guard_, __LINE__)                                          \
+        {                                                                                                              \
+            CONCAT(utilities_trace_site_, __LINE__)                                                                    \
+        }
+#else
+    #define TRACE_SCOPE(name) void(0)
+#endif
+
+/// @brief A trace span that covers the rest of the enclosing function & is named after it.
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
+
+namespace utilities {
+
+/// @brief The static information about a place in the code that generates trace events.
+/// @note  These are created by the `TRACE_SCOPE` macro & must live at fixed addresses for the lifetime of the program.
+class trace_site {
+public:
+    constexpr trace_site(std::string_view name, std::string_view func, std::string_view file, std::size_t line) :
+        m_name{name}, m_function{func}, m_filename{file}, m_line{line}
+    {}
+
+    trace_site(const trace_site&) = delete;
+    trace_site& operator=(const trace_site&) = delete;
+
+    constexpr std::string_view name() const { return m_name; }
+    constexpr std::string_view function() const { return m_function; }
+    constexpr std::string_view filename() const { return m_filename; }
+    constexpr std::size_t      line() const { return m_line; }
+
+private:
+    std::string_view m_name;     // The name given to the site.
+    std::string_view m_function; // Function/method where the site is.
+    std::string_view m_filename; // Filename where the site is (just the filename not the path).
+    std::size_t      m_line;     // Line in the file where the site is.
+};
+
+/// @brief A single trace event: the start or end of a span at a particular time.
+struct trace_event {
+    const trace_site* site;       // Where the event came from.
+    std::int64_t      timestamp;  // Nanoseconds on the `tsc_clock`.
+    char              phase;      // 'B' for the beginning of a span & 'E' for its end.
+};
+
+/// @brief Each thread records its events in its own fixed size buffer so the hot path is lock-free.
+/// @note  Only the owning thread writes events and it publishes each one by bumping an atomic count, so the events
+///        can be read safely from another thread at any time. Once a buffer is full any further events are dropped.
+class trace_buffer {
+public:
+    explicit trace_buffer(std::size_t capacity, std::size_t thread_id) : m_events(capacity), m_thread_id{thread_id} {}
+
+    /// @brief Record an event (only ever called by the owning thread).
+    void push(const trace_event& event)
+    {
+        auto n = m_size.load(std::memory_order_relaxed);
+        if (n < m_events.size()) {
+            m_events[n] = event;
+            m_size.store(n + 1, std::memory_order_release);
+        }
+        else {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief The number of events published so far -- those are safe to read.
+    std::size_t size() const { return m_size.load(std::memory_order_acquire); }
+
+    /// @brief Read-only access to a published event.
+    const trace_event& operator[](std::size_t i) const { return m_events[i]; }
+
+    /// @brief The small integer id we use for the owning thread in the trace.
+    std::size_t thread_id() const { return m_thread_id; }
+
+    /// @brief The number of events dropped because the buffer was full.
+    std::size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    /// @brief Forget all the events -- only safe when nothing is being recorded.
+    void clear()
+    {
+        m_size.store(0, std::memory_order_relaxed);
+        m_dropped.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<trace_event> m_events;      // Storage for the events.
+    std::atomic<std::size_t> m_size = 0;    // The number of events published so far.
+    std::atomic<std::size_t> m_dropped = 0; // The number of events dropped because we ran out of room.
+    std::size_t              m_thread_id;   // Id for the owning thread.
+};
+
+/// @brief The trace recorder -- all its methods are class methods.
+/// @note  Nothing is recorded until `start()` is called. Once you have collected the events you are interested in,
+///        call `write` or `save` to output them as Chrome trace event JSON. You can load that file into Perfetto
+///        (https://ui.perfetto.dev) or `chrome://tracing` to see a flame chart timeline of every thread.
+class tracer {
+public:
+    /// @brief Class method that starts recording events.
+    /// @param events_per_thread The size of each thread's event buffer (only used for threads that have yet to record).
+    static void start(std::size_t events_per_thread = 1 << 16)
+    {
+        c_events_per_thread.store(events_per_thread, std::memory_order_relaxed);
+        c_recording.store(true, std::memory_order_release);
+    }
+
+    /// @brief Class method that stops recording events.
+    static void stop() { c_recording.store(false, std::memory_order_release); }
+
+    /// @brief Class method that checks whether we are currently recording events.
+    static bool recording() { return c_recording.load(std::memory_order_relaxed); }
+
+    /// @brief Class method that records the beginning of a span on the calling thread.
+    static void begin(const trace_site& site) { local().push({&site, now(), 'B'}); }
+
+    /// @brief Class method that records the end of a span on the calling thread.
+    static void end(const trace_site& site) { local().push({&site, now(), 'E'}); }
+
+    /// @brief Class method that returns the number of events dropped so far because a thread's buffer was full.
+    static std::size_t dropped()
+    {
+        std::size_t      retval = 0;
+        std::scoped_lock lock{mutex()};
+        for (const auto& buffer : buffers()) retval += buffer->dropped();
+        return retval;
+    }
+
+    /// @brief Class method that forgets all the events recorded so far -- only safe when nothing is being recorded.
+    static void clear()
+    {
+        std::scoped_lock lock{mutex()};
+        for (auto& buffer : buffers()) buffer->clear();
+    }
+
+    /// @brief Class method that writes all the events recorded so far to a stream as Chrome trace event JSON.
+    /// @note  Events from threads that have since exited are included. Spans that are still open are left open.
+    static void write(std::ostream& os)
+    {
+        std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool        first = true;
+        auto        it = std::back_inserter(out);
+
+        std::scoped_lock lock{mutex()};
+        for (const auto& buffer : buffers()) {
+            auto tid = buffer->thread_id();
+            for (std::size_t i = 0, n = buffer->size(); i < n; ++i) {
+                const auto& e = (*buffer)[i];
+                if (!std::exchange(first, false)) out += ',';
+                out += "\n{\"name\":";
+                json_string_to(it, e.site->name());
+                out += ",\"cat\":";
+                json_string_to(it, e.site->function());
+                auto ts = static_cast<double>(e.timestamp) / 1000;
+                std::format_to(it, ",\"ph\":\"{}\",\"ts\":{:.3f},\"pid\":1,\"tid\":{},", e.phase, ts, tid);
+                out += "\"args\":{\"file\":";
+                json_string_to(it, e.site->filename());
+                std::format_to(it, ",\"line\":{}}}}}", e.site->line());
+
+                // Flush to the stream every so often to keep our scratch buffer small.
+                if (out.size() > 64 * 1024) {
+                    os.write(out.data(), static_cast<std::streamsize>(out.size()));
+                    out.clear();
+                }
+            }
+        }
+        out += "\n]}\n";
+        os.write(out.data(), static_cast<std::streamsize>(out.size()));
+    }
+
+    /// @brief Class method that saves all the events recorded so far to a file as Chrome trace event JSON.
+    /// @throw `std::runtime_error` if the file cannot be opened.
+    static void save(const std::filesystem::path& path)
+    {
+        std::ofstream file{path};
+        if (!file) throw std::runtime_error(std::format("Failed to open trace file '{}'", path.string()));
+        write(file);
+    }
+
+private:
+    inline static std::atomic<bool>        c_recording = false;
+    inline static std::atomic<std::size_t> c_events_per_thread = 1 << 16;
+
+    // Timestamps are read using the cheapest clock we have.
+    static std::int64_t now() { return tsc_clock::now().time_since_epoch().count(); }
+
+    // All the buffers -- we hold on to them after their threads exit so their events can still be written out.
+    static std::vector<std::shared_ptr<trace_buffer>>& buffers()
+    {
+        static std::vector<std::shared_ptr<trace_buffer>> retval;
+        return retval;
+    }
+
+    static std::mutex& mutex()
+    {
+        static std::mutex retval;
+        return retval;
+    }
+
+    // The buffer for the calling thread which is created & registered the first time that thread records an event.
+    static trace_buffer& local()
+    {
+        thread_local trace_buffer* retval = nullptr;
+        if (retval == nullptr) {
+            std::scoped_lock lock{mutex()};
+            auto             capacity = c_events_per_thread.load(std::memory_order_relaxed);
+            buffers().push_back(std::make_shared<trace_buffer>(capacity, buffers().size() + 1));
+            retval = buffers().back().get();
+        }
+        return *retval;
+    }
+};
+
+/// @brief An RAII guard that records the beginning and end of a span (if the tracer is recording at its start).
+/// @note  These are created by the `TRACE_SCOPE` macro.
+class trace_guard {
+public:
+    explicit trace_guard(const trace_site& site) : m_site{tracer::recording() ? &site : nullptr}
+    {
+        if (m_site) tracer::begin(*m_site);
+    }
+
+    ~trace_guard()
+    {
+        if (m_site) tracer::end(*m_site);
+    }
+
+    trace_guard(const trace_guard&) = delete;
+    trace_guard& operator=(const trace_guard&) = delete;
+
+private:
+    const trace_site* m_site; // Non-null if we recorded the beginning of the span.
+};
+
+} // namespace utilities
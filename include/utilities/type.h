@@ -4,7 +4,12 @@
 /// SPDX-License-Identifier: MIT
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
 #include <string>
+#include <string_view>
 #include <iostream>
 
 namespace utilities {
@@ -37,4 +42,101 @@ constexpr auto type(const T&)
     return type<T>();
 }
 
+/// @brief A string of fixed size @c N that can be built at compile time & used as a non-type template parameter.
+/// @note  The characters are held by value (with a trailing null) so the string doesn't refer to any other storage.
+///        The member array is public because that is what lets the type be used as a template parameter.
+template <std::size_t N>
+struct fixed_string {
+    char chars[N + 1] = {};
+
+    constexpr fixed_string() = default;
+
+    /// @brief Construct from a string literal -- this also lets @c N be deduced for a template parameter.
+    constexpr fixed_string(const char (&str)[N + 1]) { std::copy_n(str, N + 1, chars); }
+
+    /// @brief Construct from the first @c N characters of a string view.
+    constexpr explicit fixed_string(std::string_view str) { std::copy_n(str.data(), N, chars); }
+
+    static constexpr std::size_t size() { return N; }
+    static constexpr bool        empty() { return N == 0; }
+
+    constexpr const char*      data() const { return chars; }
+    constexpr const char*      c_str() const { return chars; }
+    constexpr std::string_view view() const { return {chars, N}; }
+    constexpr operator std::string_view() const { return view(); }
+
+    std::string to_string() const { return std::string{view()}; }
+
+    template <std::size_t M>
+    friend constexpr bool operator==(const fixed_string& lhs, const fixed_string<M>& rhs)
+    {
+        return lhs.view() == rhs.view();
+    }
+};
+
+// Deduction guide so that e.g. fixed_string{"abc"} is a fixed_string<3>.
+template <std::size_t M>
+fixed_string(const char (&)[M]) -> fixed_string<M - 1>;
+
+/// @brief Usual output operator.
+template <std::size_t N>
+std::ostream&
+operator<<(std::ostream& os, const fixed_string<N>& rhs)
+{
+    return os << rhs.view();
+}
+
+/// @brief Returns the name of a type as a @c fixed_string which is computed at compile time.
+/// @note  Unlike @c type<T>() the result owns its characters so it is a value you can store, compare, & use as a
+///        non-type template parameter without referring back to the compiler's function signature strings.
+template <typename T>
+constexpr auto type_name()
+{
+    constexpr auto name = type<T>();
+    return fixed_string<name.size()>{name};
+}
+
+template <typename T>
+constexpr auto type_name(const T&)
+{
+    return type_name<T>();
+}
+
+/// @brief The 64-bit FNV-1a hash of a string -- usable at compile time.
+constexpr std::uint64_t
+fnv1a_hash(std::string_view str)
+{
+    std::uint64_t retval = 0xcbf29ce484222325ull;
+    for (char c : str) {
+        retval ^= static_cast<unsigned char>(c);
+        retval *= 0x100000001b3ull;
+    }
+    return retval;
+}
+
+/// @brief Returns a 64-bit hash of the name of a type which is always computed at compile time.
+/// @note  Use these as cheap keys for types, e.g. as @c switch case labels or template parameters. They are stable
+///        for any one compiler, but like the names themselves they can differ from one compiler to another.
+template <typename T>
+consteval std::uint64_t type_hash()
+{
+    return fnv1a_hash(type<T>());
+}
+
+template <typename T>
+constexpr std::uint64_t type_hash(const T&)
+{
+    return type_hash<T>();
+}
+
 } // namespace utilities
+
+/// @brief Connect fixed strings to @c std::format & friends.
+template <std::size_t N>
+struct std::formatter<utilities::fixed_string<N>> : std::formatter<std::string_view> {
+    template <typename FormatContext>
+    auto format(const utilities::fixed_string<N>& rhs, FormatContext& ctx) const
+    {
+        return std::formatter<std::string_view>::format(rhs.view(), ctx);
+    }
+};
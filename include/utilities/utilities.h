@@ -4,13 +4,21 @@
 /// SPDX-License-Identifier: MIT
 #pragma once
 
+#include "benchmark.h"
+#include "counters.h"
 #include "format.h"
+#include "intern.h"
 #include "log.h"
 #include "macros.h"
+#include "metrics.h"
+#include "pipeline.h"
 #include "print.h"
+#include "profile.h"
 #include "stopwatch.h"
 #include "stream.h"
 #include "string.h"
 #include "thousands.h"
+#include "thread_slots.h"
+#include "trace.h"
 #include "type.h"
 #include "verify.h"
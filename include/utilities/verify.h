@@ -4,19 +4,26 @@
 /// SPDX-License-Identifier: MIT
 #pragma once
 
+#include "macros.h"
+
+#include <cstddef>
 #include <format>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <utility>
 
 /// @brief Failed verifications call this macro to exit the program using the @c utilities::exit(...) function.
 /// @note  This macro automatically adds the needed source code location information to the exit call.
-#define exit_with_message(...) utilities::exit(__func__, __FILE__, __LINE__, std::format(__VA_ARGS__))
+#define exit_with_message(...) utilities::exit_formatted(__func__, __FILE__, __LINE__, __VA_ARGS__)
 
 /// @brief The @c verify macro checks that a condition is true and if not, exits the program with a message.
 /// @param cond The condition that you want checked.
 /// @param args The other arguments hold the message to print on fails -- will be formatted by @c std::format
+/// @note  All the work of formatting & reporting a failure is done in an out-of-line "cold" function so what is left
+///        at the call site is just the check & a branch that is marked as unlikely to be taken.
 #define verify(cond, ...) \
-    if (!(cond)) exit_with_message("Statement '{}' is NOT true: {}\n", #cond, std::format(__VA_ARGS__))
+    if (!(cond)) [[unlikely]] utilities::verify_failed(__func__, __FILE__, __LINE__, #cond, __VA_ARGS__)
 
 /// @brief If the @c DEBUG flag is set this checks that a condition is true and if not, exits with a message.
 /// @param cond The condition that you want checked if the  @c DEBUG flag is set.
@@ -55,7 +62,7 @@ basename(std::string_view path)
 
 /// @brief This function prints an error message with source code location information and exits the program.
 /// @note  Generally this is only called from some macro which adds the needed location info.
-inline void
+[[noreturn]] COLD NOINLINE inline void
 exit(std::string_view func, std::string_view path, std::size_t line, std::string_view payload = "")
 {
     std::cerr << std::format("\n[VERIFY FAILED] In function '{}' ({}, line {})", func, basename(path), line);
@@ -64,4 +71,25 @@ exit(std::string_view func, std::string_view path, std::size_t line, std::string
     ::exit(1);
 }
 
+/// @brief Formats a message & then exits the program with it along with the source code location information.
+/// @note  This is what the @c exit_with_message macro calls. It is kept out of line so that the formatting code isn't
+///        expanded at every call site.
+template<typename... Args>
+[[noreturn]] COLD NOINLINE void
+exit_formatted(std::string_view func, std::string_view path, std::size_t line, std::format_string<Args...> fmt,
+               Args&&... args)
+{
+    exit(func, path, line, std::format(fmt, std::forward<Args>(args)...));
+}
+
+/// @brief Reports a failed @c verify check & exits the program -- this is the out-of-line slow path for that macro.
+template<typename... Args>
+[[noreturn]] COLD NOINLINE void
+verify_failed(std::string_view func, std::string_view path, std::size_t line, std::string_view cond,
+              std::format_string<Args...> fmt, Args&&... args)
+{
+    auto msg = std::format(fmt, std::forward<Args>(args)...);
+    exit(func, path, line, std::format("Statement '{}' is NOT true: {}\n", cond, msg));
+}
+
 } // namespace utilities